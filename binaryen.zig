@@ -8,6 +8,12 @@ pub fn freeEmit(buf: []u8) void {
     byn.free(buf.ptr);
 }
 
+/// Sets the directory in which to cache the results of optimizing functions,
+/// or disables the cache if null. Applies to all modules.
+pub fn setFunctionCache(dir: ?[*:0]const u8) void {
+    byn.BinaryenSetFunctionCache(dir);
+}
+
 pub const Module = opaque {
     pub fn init() *Module {
         const mod = byn.BinaryenModuleCreate();
@@ -42,6 +48,10 @@ pub const Module = opaque {
     }
     pub const EmitBinaryResult = struct { binary: []u8, source_map: [:0]u8 };
 
+    pub fn optimize(self: *Module) void {
+        byn.BinaryenModuleOptimize(self.c());
+    }
+
     pub fn addFunction(
         self: *Module,
         name: [*:0]const u8,
@@ -96,6 +96,7 @@ pub fn build(b: *std.Build) void {
     lib.addCSourceFiles(&.{
         "wasm_intrinsics.cpp",
 
+        "src/passes/function-cache.cpp",
         "src/passes/param-utils.cpp",
         "src/passes/pass.cpp",
         "src/passes/test_passes.cpp",
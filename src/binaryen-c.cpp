@@ -5654,6 +5654,18 @@ void BinaryenSetAllowInliningFunctionsWithLoops(bool enabled) {
   globalPassOptions.inlining.allowFunctionsWithLoops = enabled;
 }
 
+const char* BinaryenGetFunctionCache(void) {
+  if (globalPassOptions.functionCache.empty()) {
+    return nullptr;
+  }
+  // internalize the string so it remains valid while the module is
+  return Name(globalPassOptions.functionCache).str.data();
+}
+
+void BinaryenSetFunctionCache(const char* dir) {
+  globalPassOptions.functionCache = dir ? dir : "";
+}
+
 void BinaryenModuleRunPasses(BinaryenModuleRef module,
                              const char** passes,
                              BinaryenIndex numPasses) {
@@ -5680,13 +5692,18 @@ static BinaryenBufferSizes writeModule(BinaryenModuleRef module,
   BufferWithRandomAccess buffer;
   WasmBinaryWriter writer((Module*)module, buffer);
   writer.setNamesSection(globalPassOptions.debugInfo);
+  // Copy each section into the output as it is finished.
+  size_t bytes = 0;
+  writer.setStreamingOutput([&](const uint8_t* data, size_t size) {
+    auto copied = std::min(size, outputSize - bytes);
+    std::copy_n(data, copied, output + bytes);
+    bytes += copied;
+  });
   std::ostringstream os;
   if (sourceMapUrl) {
     writer.setSourceMap(&os, sourceMapUrl);
   }
   writer.write();
-  size_t bytes = std::min(buffer.size(), outputSize);
-  std::copy_n(buffer.begin(), bytes, output);
   size_t sourceMapBytes = 0;
   if (sourceMapUrl) {
     auto str = os.str();
@@ -5751,13 +5768,27 @@ BinaryenModuleAllocateAndWrite(BinaryenModuleRef module,
   BufferWithRandomAccess buffer;
   WasmBinaryWriter writer((Module*)module, buffer);
   writer.setNamesSection(globalPassOptions.debugInfo);
+  // Append each section to the malloc'd result as it is finished, so that we
+  // never hold a second copy of the entire binary.
+  char* binary = nullptr;
+  size_t binaryBytes = 0;
+  size_t capacity = 0;
+  writer.setStreamingOutput([&](const uint8_t* data, size_t size) {
+    if (binaryBytes + size > capacity) {
+      capacity = std::max(binaryBytes + size, capacity * 2);
+      binary = (char*)realloc(binary, capacity);
+    }
+    std::copy_n(data, size, binary + binaryBytes);
+    binaryBytes += size;
+  });
   std::ostringstream os;
   if (sourceMapUrl) {
     writer.setSourceMap(&os, sourceMapUrl);
   }
   writer.write();
-  void* binary = malloc(buffer.size());
-  std::copy_n(buffer.begin(), buffer.size(), static_cast<char*>(binary));
+  if (binaryBytes < capacity) {
+    binary = (char*)realloc(binary, binaryBytes);
+  }
   char* sourceMap = nullptr;
   if (sourceMapUrl) {
     auto str = os.str();
@@ -5765,7 +5796,7 @@ BinaryenModuleAllocateAndWrite(BinaryenModuleRef module,
     sourceMap = (char*)malloc(len);
     std::copy_n(str.c_str(), len, sourceMap);
   }
-  return {binary, buffer.size(), sourceMap};
+  return {binary, binaryBytes, sourceMap};
 }
 
 char* BinaryenModuleAllocateAndWriteText(BinaryenModuleRef module) {
@@ -3075,6 +3075,15 @@ BINARYEN_API bool BinaryenGetAllowInliningFunctionsWithLoops(void);
 // Applies to all modules, globally.
 BINARYEN_API void BinaryenSetAllowInliningFunctionsWithLoops(bool enabled);
 
+// Gets the directory in which the results of optimizing functions are cached,
+// or NULL if there is none. Applies to all modules, globally.
+BINARYEN_API const char* BinaryenGetFunctionCache(void);
+
+// Sets the directory in which to cache the results of optimizing functions, so
+// that functions that did not change need not be optimized again. Disables the
+// cache if `dir` is NULL. Applies to all modules, globally.
+BINARYEN_API void BinaryenSetFunctionCache(const char* dir);
+
 // Runs the specified passes on the module. Uses the currently set global
 // optimize and shrink level.
 BINARYEN_API void BinaryenModuleRunPasses(BinaryenModuleRef module,
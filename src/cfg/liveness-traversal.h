@@ -21,10 +21,13 @@
 #ifndef liveness_traversal_h
 #define liveness_traversal_h
 
+#include <queue>
+
 #include "cfg-traversal.h"
 #include "ir/utils.h"
+#include "support/bits.h"
+#include "support/hash.h"
 #include "support/sorted_vector.h"
-#include "support/sparse_square_matrix.h"
 #include "wasm-builder.h"
 #include "wasm-traversal.h"
 #include "wasm.h"
@@ -84,6 +87,7 @@ struct LivenessAction {
 struct Liveness {
   SetOfLocals start, end;              // live locals at the start and end
   std::vector<LivenessAction> actions; // actions occurring in this block
+  Index index = 0; // index among the live blocks, used while flowing
 
 #if LIVENESS_DEBUG
   void dump(Function* func) {
@@ -106,9 +110,9 @@ struct LivenessWalker : public CFGWalker<SubType, VisitorType, Liveness> {
 
   Index numLocals;
   std::unordered_set<BasicBlock*> liveBlocks;
-  // access as a upper triangular matrix: i.e. when accessing a pair (i,j),
-  // should access the cell i < j.
-  sparse_square_matrix<uint8_t> copies;
+  // The number of copies between pairs of locals, keyed by (high, low). Most
+  // pairs have none, so only the ones that do are stored.
+  std::unordered_map<std::pair<Index, Index>, uint8_t> copies;
 
   // total # of copies for each local, with all others
   std::vector<Index> totalCopies;
@@ -196,7 +200,7 @@ struct LivenessWalker : public CFGWalker<SubType, VisitorType, Liveness> {
 
   void doWalkFunction(Function* func) {
     numLocals = func->getNumLocals();
-    copies.recreate(numLocals);
+    copies.clear();
     totalCopies.clear();
     totalCopies.resize(numLocals);
     // create the CFG by walking the IR
@@ -209,73 +213,121 @@ struct LivenessWalker : public CFGWalker<SubType, VisitorType, Liveness> {
     flowLiveness();
   }
 
+  // Liveness is flowed as bitsets of locals, so that merging and comparing
+  // handles 64 locals at a time. To bound memory usage on functions with many
+  // locals and blocks, we flow a range of locals at a time, picked so that the
+  // bitsets for all the blocks fit in this many words.
+  static const size_t MaxFlowWords = size_t(1) << 20;
+
   void flowLiveness() {
-    // keep working while stuff is flowing
-    std::unordered_set<BasicBlock*> queue;
+    // Index the live blocks, as the worklist is ordered by those indexes.
+    std::vector<BasicBlock*> blocks;
     for (auto& curr : CFGWalker<SubType, VisitorType, Liveness>::basicBlocks) {
       if (liveBlocks.count(curr.get()) == 0) {
         continue; // ignore dead blocks
       }
-      queue.insert(curr.get());
-      // do the first scan through the block, starting with nothing live at the
-      // end, and updating the liveness at the start
-      scanLivenessThroughActions(curr->contents.actions, curr->contents.start);
-    }
-    // at every point in time, we assume we already noted interferences between
-    // things already known alive at the end, and scanned back through the block
-    // using that
-    while (queue.size() > 0) {
-      auto iter = queue.begin();
-      auto* curr = *iter;
-      queue.erase(iter);
-      SetOfLocals live;
-      if (!mergeStartsAndCheckChange(curr->out, curr->contents.end, live)) {
-        continue;
-      }
-      assert(curr->contents.end.size() < live.size());
-      curr->contents.end = live;
-      scanLivenessThroughActions(curr->contents.actions, live);
-      // liveness is now calculated at the start. if something
-      // changed, all predecessor blocks need recomputation
-      if (curr->contents.start == live) {
-        continue;
-      }
-      assert(curr->contents.start.size() < live.size());
-      curr->contents.start = live;
-      for (auto* in : curr->in) {
-        queue.insert(in);
-      }
+      curr->contents.index = blocks.size();
+      blocks.push_back(curr.get());
     }
-  }
-
-  // merge starts of a list of blocks. return
-  // whether anything changed vs an old state (which indicates further
-  // processing is necessary).
-  bool mergeStartsAndCheckChange(std::vector<BasicBlock*>& blocks,
-                                 SetOfLocals& old,
-                                 SetOfLocals& ret) {
-    if (blocks.size() == 0) {
-      return false;
+    auto numBlocks = blocks.size();
+    if (numBlocks == 0 || numLocals == 0) {
+      return;
     }
-    ret = blocks[0]->contents.start;
-    if (blocks.size() > 1) {
-      // more than one, so we must merge
-      for (Index i = 1; i < blocks.size(); i++) {
-        ret = ret.merge(blocks[i]->contents.start);
+    // Only the first action on each local in a block matters: if it is a get
+    // then the local is live at the start of the block no matter what comes
+    // after, and if it is a set then the local is not live at the start, no
+    // matter what is live at the end.
+    std::vector<Index> gens, kills;
+    std::vector<size_t> gensStart(numBlocks + 1), killsStart(numBlocks + 1);
+    std::vector<Index> seen(numLocals, Index(-1));
+    for (Index i = 0; i < numBlocks; i++) {
+      gensStart[i] = gens.size();
+      killsStart[i] = kills.size();
+      for (auto& action : blocks[i]->contents.actions) {
+        if (action.isOther() || seen[action.index] == i) {
+          continue;
+        }
+        seen[action.index] = i;
+        (action.isGet() ? gens : kills).push_back(action.index);
       }
     }
-    return old != ret;
-  }
+    gensStart[numBlocks] = gens.size();
+    killsStart[numBlocks] = kills.size();
 
-  void scanLivenessThroughActions(std::vector<LivenessAction>& actions,
-                                  SetOfLocals& live) {
-    // move towards the front
-    for (int i = int(actions.size()) - 1; i >= 0; i--) {
-      auto& action = actions[i];
-      if (action.isGet()) {
-        live.insert(action.index);
-      } else if (action.isSet()) {
-        live.erase(action.index);
+    size_t totalWords = (numLocals + 63) / 64;
+    size_t chunkWords =
+      std::max(size_t(1), std::min(totalWords, MaxFlowWords / numBlocks));
+    std::vector<uint64_t> starts(numBlocks * chunkWords);
+    std::vector<uint64_t> live(chunkWords);
+    std::vector<bool> queued(numBlocks);
+    for (size_t firstWord = 0; firstWord < totalWords;
+         firstWord += chunkWords) {
+      auto words = std::min(chunkWords, totalWords - firstWord);
+      Index lo = firstWord * 64;
+      Index hi = std::min(size_t(numLocals), lo + words * 64);
+      std::fill(starts.begin(), starts.end(), 0);
+      auto mergeEnd = [&](BasicBlock* block) {
+        std::fill(live.begin(), live.begin() + words, 0);
+        for (auto* out : block->out) {
+          auto* start = &starts[out->contents.index * chunkWords];
+          for (size_t w = 0; w < words; w++) {
+            live[w] |= start[w];
+          }
+        }
+      };
+      // Liveness flows backwards, so work on later blocks first, as they are
+      // usually the successors of earlier ones. That way a block is mostly
+      // processed after its successors, and loops converge quickly.
+      std::priority_queue<Index> work;
+      for (Index i = 0; i < numBlocks; i++) {
+        work.push(i);
+        queued[i] = true;
+      }
+      while (!work.empty()) {
+        auto i = work.top();
+        work.pop();
+        queued[i] = false;
+        mergeEnd(blocks[i]);
+        for (auto k = killsStart[i]; k < killsStart[i + 1]; k++) {
+          if (kills[k] >= lo && kills[k] < hi) {
+            auto bit = kills[k] - lo;
+            live[bit / 64] &= ~(uint64_t(1) << (bit % 64));
+          }
+        }
+        for (auto g = gensStart[i]; g < gensStart[i + 1]; g++) {
+          if (gens[g] >= lo && gens[g] < hi) {
+            auto bit = gens[g] - lo;
+            live[bit / 64] |= uint64_t(1) << (bit % 64);
+          }
+        }
+        auto* start = &starts[i * chunkWords];
+        if (std::equal(live.begin(), live.begin() + words, start)) {
+          continue;
+        }
+        // Liveness at the start grew, so the predecessors need an update.
+        std::copy(live.begin(), live.begin() + words, start);
+        for (auto* in : blocks[i]->in) {
+          auto j = in->contents.index;
+          if (!queued[j]) {
+            work.push(j);
+            queued[j] = true;
+          }
+        }
+      }
+      // Append this range of locals to the sets, which keeps them sorted.
+      auto append = [&](const uint64_t* bits, SetOfLocals& set) {
+        for (size_t w = 0; w < words; w++) {
+          auto word = bits[w];
+          while (word) {
+            set.push_back(lo + w * 64 + Bits::countTrailingZeroes(word));
+            word &= word - 1;
+          }
+        }
+      };
+      for (Index i = 0; i < numBlocks; i++) {
+        append(&starts[i * chunkWords], blocks[i]->contents.start);
+        mergeEnd(blocks[i]);
+        append(live.data(), blocks[i]->contents.end);
       }
     }
   }
@@ -284,7 +336,8 @@ struct LivenessWalker : public CFGWalker<SubType, VisitorType, Liveness> {
     if (j > i) {
       std::swap(i, j);
     }
-    copies.set(i, j, std::min(copies.get(i, j), uint8_t(254)) + 1);
+    auto& count = copies[{i, j}];
+    count = std::min(count, uint8_t(254)) + 1;
     totalCopies[i]++;
     totalCopies[j]++;
   }
@@ -293,7 +346,8 @@ struct LivenessWalker : public CFGWalker<SubType, VisitorType, Liveness> {
     if (j > i) {
       std::swap(i, j);
     }
-    return copies.get(i, j);
+    auto iter = copies.find({i, j});
+    return iter == copies.end() ? 0 : iter->second;
   }
 };
 
@@ -14,11 +14,13 @@
  * limitations under the License.
  */
 
+#include <deque>
 #include <iterator>
 
 #include <cfg/cfg-traversal.h>
 #include <ir/find_all.h>
 #include <ir/local-graph.h>
+#include <support/bits.h>
 #include <wasm-builder.h>
 
 namespace wasm {
@@ -27,27 +29,83 @@ namespace LocalGraphInternal {
 
 // Information about a basic block.
 struct Info {
-  // actions occurring in this block: local.gets and local.sets
-  std::vector<Expression*> actions;
-  // for each index, the last local.set for it
-  std::unordered_map<Index, LocalSet*> lastSets;
+  // The index of the block in basicBlocks.
+  Index index;
+  // actions occurring in this block: local.gets and local.sets. for a get we
+  // also note its index in the list of all gets.
+  std::vector<std::pair<Expression*, Index>> actions;
 };
 
+// Helpers for bitsets stored in words.
+static void setBit(uint64_t* words, size_t bit) {
+  words[bit / 64] |= uint64_t(1) << (bit % 64);
+}
+
+// Clears the bits [from, to).
+static void clearBits(uint64_t* words, size_t from, size_t to) {
+  while (from < to) {
+    auto shift = from % 64;
+    auto count = std::min(64 - shift, to - from);
+    auto mask = count == 64 ? ~uint64_t(0) : ((uint64_t(1) << count) - 1);
+    words[from / 64] &= ~(mask << shift);
+    from += count;
+  }
+}
+
+// Calls a function on each set bit in [from, to), in order.
+template<typename F>
+static void forEachBit(const uint64_t* words, size_t from, size_t to, F f) {
+  while (from < to) {
+    auto shift = from % 64;
+    auto count = std::min(64 - shift, to - from);
+    auto mask = count == 64 ? ~uint64_t(0) : ((uint64_t(1) << count) - 1);
+    auto bits = (words[from / 64] >> shift) & mask;
+    while (bits) {
+      f(from + Bits::countTrailingZeroes(bits));
+      bits &= bits - 1;
+    }
+    from += count;
+  }
+}
+
 // flow helper class. flows the gets to their sets
 
 struct Flower : public CFGWalker<Flower, Visitor<Flower>, Info> {
-  LocalGraph::GetSetses& getSetses;
   LocalGraph::Locations& locations;
 
-  Flower(LocalGraph::GetSetses& getSetses,
-         LocalGraph::Locations& locations,
-         Function* func)
-    : getSetses(getSetses), locations(locations) {
+  // All the reachable gets, in the order they appear.
+  std::vector<LocalGet*> gets;
+
+  // The block of each get, and its index. We note the index as it may be
+  // modified while we are lazy, but what we compute must reflect the function
+  // as it was.
+  std::vector<Index> getBlocks;
+  std::vector<Index> getLocals;
+
+  // The set of each get, if there is one before it in its block.
+  std::vector<LocalSet*> localSets;
+
+  // A get that reads the value that flows into its block.
+  struct ExposedGet {
+    Index block;
+    Index get;
+  };
+  std::vector<ExposedGet> exposedGets;
+
+  // Whether each local index has exposed gets.
+  std::vector<bool> exposedIndexes;
+
+  // The last set of each index in each block, which is what the block flows
+  // out. Those of block i are at [lastSetsStart[i], lastSetsStart[i + 1]).
+  std::vector<std::pair<Index, LocalSet*>> lastSets;
+  std::vector<size_t> lastSetsStart;
+
+  Flower(LocalGraph::Locations& locations, Function* func)
+    : locations(locations) {
     setFunction(func);
     // create the CFG by walking the IR
     CFGWalker<Flower, Visitor<Flower>, Info>::doWalkFunction(func);
-    // flow gets across blocks
-    flow(func);
+    scanBlocks(func);
   }
 
   BasicBlock* makeBasicBlock() { return new BasicBlock(); }
@@ -60,7 +118,9 @@ struct Flower : public CFGWalker<Flower, Visitor<Flower>, Info> {
     if (!self->currBasicBlock) {
       return;
     }
-    self->currBasicBlock->contents.actions.emplace_back(curr);
+    self->currBasicBlock->contents.actions.emplace_back(curr,
+                                                        self->gets.size());
+    self->gets.push_back(curr);
     self->locations[curr] = currp;
   }
 
@@ -70,156 +130,310 @@ struct Flower : public CFGWalker<Flower, Visitor<Flower>, Info> {
     if (!self->currBasicBlock) {
       return;
     }
-    self->currBasicBlock->contents.actions.emplace_back(curr);
-    self->currBasicBlock->contents.lastSets[curr->index] = curr;
+    self->currBasicBlock->contents.actions.emplace_back(curr, 0);
     self->locations[curr] = currp;
   }
 
-  void flow(Function* func) {
-    // This block struct is optimized for this flow process (Minimal
-    // information, iteration index).
-    struct FlowBlock {
-      // Last Traversed Iteration: This value helps us to find if this block has
-      // been seen while traversing blocks. We compare this value to the current
-      // iteration index in order to determine if we already process this block
-      // in the current iteration. This speeds up the processing compared to
-      // unordered_set or other struct usage. (No need to reset internal values,
-      // lookup into container, ...)
-      size_t lastTraversedIteration;
-      std::vector<Expression*> actions;
-      std::vector<FlowBlock*> in;
-      // Sor each index, the last local.set for it
-      // The unordered_map from BasicBlock.Info is converted into a vector
-      // This speeds up search as there are usually few sets in a block, so just
-      // scanning them linearly is efficient, avoiding hash computations (while
-      // in Info, it's convenient to have a map so we can assign them easily,
-      // where the last one seen overwrites the previous; and, we do that O(1)).
-      std::vector<std::pair<Index, LocalSet*>> lastSets;
-    };
-
+  void scanBlocks(Function* func) {
     auto numLocals = func->getNumLocals();
-    std::vector<std::vector<LocalGet*>> allGets;
-    allGets.resize(numLocals);
-    std::vector<FlowBlock*> work;
-
-    // Convert input blocks (basicBlocks) into more efficient flow blocks to
-    // improve memory access.
-    std::vector<FlowBlock> flowBlocks;
-    flowBlocks.resize(basicBlocks.size());
-
-    // Init mapping between basicblocks and flowBlocks
-    std::unordered_map<BasicBlock*, FlowBlock*> basicToFlowMap;
-    for (Index i = 0; i < basicBlocks.size(); ++i) {
-      basicToFlowMap[basicBlocks[i].get()] = &flowBlocks[i];
+    auto numBlocks = basicBlocks.size();
+    for (Index i = 0; i < numBlocks; i++) {
+      basicBlocks[i]->contents.index = i;
     }
 
-    const size_t NULL_ITERATION = -1;
-
-    FlowBlock* entryFlowBlock = nullptr;
-    for (Index i = 0; i < flowBlocks.size(); ++i) {
-      auto& block = basicBlocks[i];
-      auto& flowBlock = flowBlocks[i];
-      // Get the equivalent block to entry in the flow list
-      if (block.get() == entry) {
-        entryFlowBlock = &flowBlock;
+    // First, look inside each block. A get that has a set of its index before
+    // it in the block has just that set. Otherwise it reads what flows into
+    // the block, and we leave it for later.
+    getBlocks.resize(gets.size());
+    getLocals.resize(gets.size());
+    localSets.resize(gets.size());
+    exposedIndexes.resize(numLocals);
+    lastSetsStart.resize(numBlocks + 1);
+    std::vector<LocalSet*> currSets(numLocals);
+    for (Index i = 0; i < numBlocks; i++) {
+      lastSetsStart[i] = lastSets.size();
+      auto& actions = basicBlocks[i]->contents.actions;
+      for (auto& [action, getIndex] : actions) {
+        if (auto* get = action->dynCast<LocalGet>()) {
+          getBlocks[getIndex] = i;
+          getLocals[getIndex] = get->index;
+          if (auto* set = currSets[get->index]) {
+            localSets[getIndex] = set;
+          } else {
+            exposedGets.push_back({i, getIndex});
+            exposedIndexes[get->index] = true;
+          }
+        } else {
+          auto* set = action->cast<LocalSet>();
+          if (!currSets[set->index]) {
+            lastSets.emplace_back(set->index, nullptr);
+          }
+          currSets[set->index] = set;
+        }
       }
-      flowBlock.lastTraversedIteration = NULL_ITERATION;
-      flowBlock.actions.swap(block->contents.actions);
-      // Map in block to flow blocks
-      auto& in = block->in;
-      flowBlock.in.resize(in.size());
-      std::transform(in.begin(),
-                     in.end(),
-                     flowBlock.in.begin(),
-                     [&](BasicBlock* block) { return basicToFlowMap[block]; });
-      // Convert unordered_map to vector.
-      flowBlock.lastSets.reserve(block->contents.lastSets.size());
-      for (auto set : block->contents.lastSets) {
-        flowBlock.lastSets.emplace_back(set);
+      for (auto k = lastSetsStart[i]; k < lastSets.size(); k++) {
+        auto& [index, set] = lastSets[k];
+        set = currSets[index];
+        currSets[index] = nullptr;
       }
+      // We have all we need from the actions.
+      std::vector<std::pair<Expression*, Index>>().swap(actions);
     }
-    assert(entryFlowBlock != nullptr);
+    lastSetsStart[numBlocks] = lastSets.size();
+  }
 
-    size_t currentIteration = 0;
-    for (auto& block : flowBlocks) {
-#ifdef LOCAL_GRAPH_DEBUG
-      std::cout << "basic block " << &block << " :\n";
-      for (auto& action : block.actions) {
-        std::cout << "  action: " << *action << '\n';
+  // Computes the sets of all the gets.
+  FlatMultimap<LocalGet*, LocalSet*> computeAll() {
+    // The sets we find for each get, by the index of the get in |gets|.
+    std::vector<std::pair<Index, LocalSet*>> found;
+    for (Index i = 0; i < gets.size(); i++) {
+      if (localSets[i]) {
+        found.emplace_back(i, localSets[i]);
+      }
+    }
+    if (!exposedGets.empty()) {
+      flowExposedGets(found);
+    }
+
+    // Order by get, keeping the sets of each get in the order we found them.
+    std::stable_sort(found.begin(), found.end(), [](auto& a, auto& b) {
+      return a.first < b.first;
+    });
+    std::vector<std::pair<LocalGet*, LocalSet*>> pairs;
+    pairs.reserve(found.size());
+    for (auto& [getIndex, set] : found) {
+      pairs.emplace_back(gets[getIndex], set);
+    }
+    return FlatMultimap<LocalGet*, LocalSet*>(pairs);
+  }
+
+  // The most words of bitsets we use for all the blocks at once. If we need
+  // more than that, we flow the definitions in chunks, one after another.
+  static const size_t MaxFlowWords = size_t(1) << 20;
+
+  // Finds the sets of the exposed gets. We number the sets that blocks flow
+  // out, and the initial value of each index, which we call definitions, and
+  // find which definitions reach the start of each block, as bitsets. Only
+  // indexes with exposed gets matter, which are usually a small part of them.
+  void flowExposedGets(std::vector<std::pair<Index, LocalSet*>>& found) {
+    auto numLocals = getFunction()->getNumLocals();
+    auto numBlocks = basicBlocks.size();
+
+    // The definitions of an index are numbered consecutively, starting with
+    // the initial value, which is a nullptr set. Those of index i are at
+    // [defsStart[i], defsStart[i + 1]).
+    std::vector<size_t> defsStart(numLocals + 1);
+    for (auto& [index, set] : lastSets) {
+      if (exposedIndexes[index]) {
+        defsStart[index + 1]++;
       }
-      for (auto& val : block.lastSets) {
-        std::cout << "  last set " << val.second << '\n';
+    }
+    for (Index i = 0; i < numLocals; i++) {
+      defsStart[i + 1] += defsStart[i] + (exposedIndexes[i] ? 1 : 0);
+    }
+    auto numDefs = defsStart[numLocals];
+    std::vector<LocalSet*> defSets(numDefs);
+    // The definition of each of lastSets, if it is of an exposed index.
+    const size_t NoDef = -1;
+    std::vector<size_t> lastSetDefs(lastSets.size(), NoDef);
+    std::vector<size_t> nextDefs(defsStart.begin(), defsStart.end() - 1);
+    for (size_t k = 0; k < lastSets.size(); k++) {
+      auto& [index, set] = lastSets[k];
+      if (exposedIndexes[index]) {
+        lastSetDefs[k] = ++nextDefs[index];
+        defSets[lastSetDefs[k]] = set;
       }
-#endif
-      // go through the block, finding each get and adding it to its index,
-      // and seeing how sets affect that
-      auto& actions = block.actions;
-      // move towards the front, handling things as we go
-      for (int i = int(actions.size()) - 1; i >= 0; i--) {
-        auto* action = actions[i];
-        if (auto* get = action->dynCast<LocalGet>()) {
-          allGets[get->index].push_back(get);
-        } else {
-          // This set is the only set for all those gets.
-          auto* set = action->cast<LocalSet>();
-          auto& gets = allGets[set->index];
-          for (auto* get : gets) {
-            getSetses[get].insert(set);
+    }
+
+    auto totalWords = (numDefs + 63) / 64;
+    auto chunkWords =
+      std::max(size_t(1), std::min(totalWords, MaxFlowWords / numBlocks));
+    std::vector<uint64_t> outs(numBlocks * chunkWords);
+    std::vector<uint64_t> in(chunkWords);
+    std::vector<bool> queued(numBlocks);
+    std::deque<Index> work;
+
+    for (size_t firstWord = 0; firstWord < totalWords;
+         firstWord += chunkWords) {
+      // This chunk has the definitions [lo, hi), and the bit of definition d
+      // is d - lo.
+      auto words = std::min(chunkWords, totalWords - firstWord);
+      auto lo = firstWord * 64;
+      auto hi = std::min(numDefs, (firstWord + words) * 64);
+      auto getBlockOut = [&](Index i) { return &outs[i * chunkWords]; };
+      auto computeIn = [&](Index i) {
+        std::fill(in.begin(), in.begin() + words, 0);
+        auto* block = basicBlocks[i].get();
+        for (auto* pred : block->in) {
+          auto* predOut = getBlockOut(pred->contents.index);
+          for (size_t w = 0; w < words; w++) {
+            in[w] |= predOut[w];
           }
-          gets.clear();
         }
+        if (block == entry) {
+          for (Index index = 0; index < numLocals; index++) {
+            auto def = defsStart[index];
+            if (exposedIndexes[index] && def >= lo && def < hi) {
+              setBit(in.data(), def - lo);
+            }
+          }
+        }
+      };
+
+      std::fill(outs.begin(), outs.end(), 0);
+      for (Index i = 0; i < numBlocks; i++) {
+        work.push_back(i);
+        queued[i] = true;
       }
-      // If anything is left, we must flow it back through other blocks. we
-      // can do that for all gets as a whole, they will get the same results.
-      for (Index index = 0; index < numLocals; index++) {
-        auto& gets = allGets[index];
-        if (gets.empty()) {
+      while (!work.empty()) {
+        auto i = work.front();
+        work.pop_front();
+        queued[i] = false;
+        // The block flows out what flows in, except for the indexes it sets.
+        computeIn(i);
+        for (auto k = lastSetsStart[i]; k < lastSetsStart[i + 1]; k++) {
+          auto def = lastSetDefs[k];
+          if (def == NoDef) {
+            continue;
+          }
+          auto index = lastSets[k].first;
+          auto from = std::max(defsStart[index], lo);
+          auto to = std::min(defsStart[index + 1], hi);
+          if (from < to) {
+            clearBits(in.data(), from - lo, to - lo);
+          }
+          if (def >= lo && def < hi) {
+            setBit(in.data(), def - lo);
+          }
+        }
+        auto* out = getBlockOut(i);
+        if (std::equal(in.begin(), in.begin() + words, out)) {
           continue;
         }
-        work.push_back(&block);
-        // Note that we may need to revisit the later parts of this initial
-        // block, if we are in a loop, so don't mark it as seen.
-        while (!work.empty()) {
-          auto* curr = work.back();
-          work.pop_back();
-          // We have gone through this block; now we must handle flowing to
-          // the inputs.
-          if (curr->in.empty()) {
-            if (curr == entryFlowBlock) {
-              // These receive a param or zero init value.
-              for (auto* get : gets) {
-                getSetses[get].insert(nullptr);
-              }
-            }
-          } else {
-            for (auto* pred : curr->in) {
-              if (pred->lastTraversedIteration == currentIteration) {
-                // We've already seen pred in this iteration.
-                continue;
-              }
-              pred->lastTraversedIteration = currentIteration;
-              auto lastSet =
-                std::find_if(pred->lastSets.begin(),
-                             pred->lastSets.end(),
-                             [&](std::pair<Index, LocalSet*>& value) {
-                               return value.first == index;
-                             });
-              if (lastSet != pred->lastSets.end()) {
-                // There is a set here, apply it, and stop the flow.
-                for (auto* get : gets) {
-                  getSetses[get].insert(lastSet->second);
-                }
-              } else {
-                // Keep on flowing.
-                work.push_back(pred);
-              }
-            }
+        std::copy(in.begin(), in.begin() + words, out);
+        for (auto* succ : basicBlocks[i]->out) {
+          auto j = succ->contents.index;
+          if (!queued[j]) {
+            work.push_back(j);
+            queued[j] = true;
           }
         }
-        gets.clear();
-        currentIteration++;
       }
+
+      // An exposed get has the definitions of its index that reach the start
+      // of its block. The exposed gets are in the order of their blocks, so we
+      // compute what reaches each block just once.
+      Index inBlock = -1;
+      for (auto& [block, getIndex] : exposedGets) {
+        auto index = getLocals[getIndex];
+        auto from = std::max(defsStart[index], lo);
+        auto to = std::min(defsStart[index + 1], hi);
+        if (from >= to) {
+          continue;
+        }
+        if (block != inBlock) {
+          computeIn(block);
+          inBlock = block;
+        }
+        forEachBit(in.data(), from - lo, to - lo, [&](size_t bit) {
+          found.emplace_back(getIndex, defSets[lo + bit]);
+        });
+      }
+    }
+  }
+
+  // Lazy computation of the sets of single gets.
+
+  std::unordered_map<LocalGet*, Index> getIndexes;
+
+  // The sets of each get, if we computed them.
+  std::vector<LocalGraph::Sets> lazySets;
+  std::vector<bool> lazyKnown;
+
+  // The sets of an index that reach the start of a block, by the block and
+  // the index, and the storage for them.
+  std::unordered_map<uint64_t, LocalGraph::Sets> blockSets;
+  std::deque<std::vector<LocalSet*>> blockSetsStorage;
+
+  // The last iteration in which we visited each block.
+  std::vector<size_t> visited;
+  size_t iteration = 0;
+
+  const LocalGraph::Sets& getSetsLazily(LocalGet* get) {
+    if (getIndexes.empty()) {
+      for (Index i = 0; i < gets.size(); i++) {
+        getIndexes[gets[i]] = i;
+      }
+      lazySets.resize(gets.size());
+      lazyKnown.resize(gets.size());
+      visited.resize(basicBlocks.size(), -1);
+    }
+    auto iter = getIndexes.find(get);
+    if (iter == getIndexes.end()) {
+      static const LocalGraph::Sets none;
+      return none;
     }
+    auto getIndex = iter->second;
+    auto& sets = lazySets[getIndex];
+    if (!lazyKnown[getIndex]) {
+      lazyKnown[getIndex] = true;
+      if (localSets[getIndex]) {
+        sets = LocalGraph::Sets(&localSets[getIndex], 1);
+      } else {
+        sets = getBlockSets(getBlocks[getIndex], getLocals[getIndex]);
+      }
+    }
+    return sets;
+  }
+
+  // Finds the sets of an index that reach the start of a block, by flowing
+  // back from it through the CFG until we find sets of the index.
+  LocalGraph::Sets getBlockSets(Index block, Index index) {
+    auto key = (uint64_t(block) << 32) | index;
+    auto iter = blockSets.find(key);
+    if (iter != blockSets.end()) {
+      return iter->second;
+    }
+    // The sets we reach, with the index of their block plus one, or zero for
+    // the initial value, so that we can sort them as computeAll() does.
+    std::vector<std::pair<Index, LocalSet*>> reached;
+    iteration++;
+    std::vector<BasicBlock*> work = {basicBlocks[block].get()};
+    while (!work.empty()) {
+      auto* curr = work.back();
+      work.pop_back();
+      if (curr == entry) {
+        reached.emplace_back(0, nullptr);
+      }
+      for (auto* pred : curr->in) {
+        auto i = pred->contents.index;
+        if (visited[i] == iteration) {
+          continue;
+        }
+        visited[i] = iteration;
+        if (auto* set = getLastSet(i, index)) {
+          reached.emplace_back(i + 1, set);
+        } else {
+          work.push_back(pred);
+        }
+      }
+    }
+    std::sort(reached.begin(), reached.end());
+    reached.erase(std::unique(reached.begin(), reached.end()), reached.end());
+    auto& storage = blockSetsStorage.emplace_back();
+    for (auto& [_, set] : reached) {
+      storage.push_back(set);
+    }
+    return blockSets[key] = LocalGraph::Sets(storage.data(), storage.size());
+  }
+
+  LocalSet* getLastSet(Index block, Index index) {
+    for (auto k = lastSetsStart[block]; k < lastSetsStart[block + 1]; k++) {
+      if (lastSets[k].first == index) {
+        return lastSets[k].second;
+      }
+    }
+    return nullptr;
   }
 };
 
@@ -227,8 +441,47 @@ struct Flower : public CFGWalker<Flower, Visitor<Flower>, Info> {
 
 // LocalGraph implementation
 
-LocalGraph::LocalGraph(Function* func) : func(func) {
-  LocalGraphInternal::Flower flower(getSetses, locations, func);
+LocalGraph::GetSetses::GetSetses() = default;
+
+LocalGraph::GetSetses::~GetSetses() = default;
+
+const LocalGraph::Sets& LocalGraph::GetSetses::operator[](LocalGet* get) {
+  if (flower && !computedAll) {
+    return flower->getSetsLazily(get);
+  }
+  return all[get];
+}
+
+LocalGraph::GetSetses::const_iterator LocalGraph::GetSetses::begin() {
+  computeAll();
+  return all.begin();
+}
+
+LocalGraph::GetSetses::const_iterator LocalGraph::GetSetses::end() {
+  computeAll();
+  return all.end();
+}
+
+size_t LocalGraph::GetSetses::size() {
+  computeAll();
+  return all.size();
+}
+
+void LocalGraph::GetSetses::computeAll() {
+  if (flower && !computedAll) {
+    // Keep the flower around, as sets we returned lazily point into it.
+    all = flower->computeAll();
+    computedAll = true;
+  }
+}
+
+LocalGraph::LocalGraph(Function* func, Mode mode) : func(func) {
+  auto flower = std::make_unique<LocalGraphInternal::Flower>(locations, func);
+  if (mode == Lazy) {
+    getSetses.flower = std::move(flower);
+    return;
+  }
+  getSetses.all = flower->computeAll();
 
 #ifdef LOCAL_GRAPH_DEBUG
   std::cout << "LocalGraph::dump\n";
@@ -280,50 +533,64 @@ bool LocalGraph::equivalent(LocalGet* a, LocalGet* b) {
 }
 
 void LocalGraph::computeSetInfluences() {
-  for (auto& [curr, _] : locations) {
-    if (auto* get = curr->dynCast<LocalGet>()) {
-      for (auto* set : getSetses[get]) {
-        setInfluences[set].insert(get);
+  std::vector<std::pair<LocalSet*, LocalGet*>> pairs;
+  for (auto& [get, sets] : getSetses) {
+    for (auto* set : sets) {
+      if (set) {
+        pairs.emplace_back(set, get);
       }
     }
   }
+  setInfluences = decltype(setInfluences)(pairs);
 }
 
 void LocalGraph::computeGetInfluences() {
-  for (auto& [curr, _] : locations) {
-    if (auto* set = curr->dynCast<LocalSet>()) {
+  std::vector<std::pair<LocalGet*, LocalSet*>> pairs;
+  FindAll<LocalSet> sets(func->body);
+  for (auto* set : sets.list) {
+    if (locations.count(set)) {
       FindAll<LocalGet> findAll(set->value);
       for (auto* get : findAll.list) {
-        getInfluences[get].insert(set);
+        pairs.emplace_back(get, set);
       }
     }
   }
+  getInfluences = decltype(getInfluences)(pairs);
 }
 
 void LocalGraph::computeSSAIndexes() {
-  std::unordered_map<Index, std::set<LocalSet*>> indexSets;
+  // For each index, the one set that the gets read, or nullptr if there is
+  // none or more than one.
+  auto numLocals = func->getNumLocals();
+  std::vector<LocalSet*> indexSets(numLocals);
+  std::vector<bool> valid(numLocals);
+  std::vector<bool> seen(numLocals);
   for (auto& [get, sets] : getSetses) {
     for (auto* set : sets) {
-      indexSets[get->index].insert(set);
+      auto index = get->index;
+      if (!seen[index]) {
+        seen[index] = true;
+        indexSets[index] = set;
+        valid[index] = true;
+      } else if (indexSets[index] != set) {
+        valid[index] = false;
+      }
     }
   }
   for (auto& [curr, _] : locations) {
     if (auto* set = curr->dynCast<LocalSet>()) {
-      auto& sets = indexSets[set->index];
-      if (sets.size() == 1 && *sets.begin() != curr) {
-        // While it has just one set, it is not the right one (us),
+      if (indexSets[set->index] != set) {
+        // While it may have just one set, it is not the right one (us),
         // so mark it invalid.
-        sets.clear();
+        valid[set->index] = false;
       }
     }
   }
-  for (auto& [index, sets] : indexSets) {
-    if (sets.size() == 1) {
-      SSAIndexes.insert(index);
-    }
-  }
+  SSAIndexes = std::move(valid);
 }
 
-bool LocalGraph::isSSA(Index x) { return SSAIndexes.count(x); }
+bool LocalGraph::isSSA(Index x) {
+  return x < SSAIndexes.size() && SSAIndexes[x];
+}
 
 } // namespace wasm
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2023 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// A cache of the effects of expressions, for passes that compute the effects of
+// many nested expressions. Creating an EffectAnalyzer for an expression walks
+// everything under it, so doing that for each of a chain of nested expressions
+// takes quadratic time. Here the effects of the expressions we were asked
+// about are cached, and when a later expression contains them, their effects
+// are merged in rather than walked again.
+//
+// Caching has a cost, as we must track what is in each cached expression in
+// order to invalidate it. To avoid that cost when there is nothing to gain, we
+// only cache large expressions that contain an expression we were asked about
+// before, that is, when we see that queries are nested.
+//
+// The cache is keyed on expressions, and so it must be told when an
+// expression is modified or replaced, by calling invalidate() on it. That also
+// invalidates the cached expressions it is nested in. A walker can do that for
+// replaceCurrent() by overriding it, for example
+//
+//  Expression* replaceCurrent(Expression* expression) {
+//    effectCache.invalidate(getCurrent());
+//    return Super::replaceCurrent(expression);
+//  }
+//
+// Modifications made in other ways must call invalidate() themselves.
+//
+
+#ifndef wasm_ir_effect_cache_h
+#define wasm_ir_effect_cache_h
+
+#include <bitset>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ir/effects.h"
+#include "pass.h"
+#include "support/index.h"
+#include "wasm.h"
+
+namespace wasm {
+
+class EffectCache {
+public:
+  // The smallest number of expressions in a cached expression.
+  static const Index MinSize = 16;
+
+  EffectCache(const PassOptions& passOptions, Module& module)
+    : passOptions(passOptions), module(module) {}
+
+  // Returns the same effects as EffectAnalyzer(passOptions, module, curr).
+  EffectAnalyzer get(Expression* curr) {
+    auto iter = cache.find(curr);
+    if (iter != cache.end()) {
+      return iter->second.effects;
+    }
+    EffectAnalyzer effects(passOptions, module);
+    walked.list.clear();
+    walked.size = 0;
+    walked.nested = false;
+    effects.pre();
+    EffectAnalyzer::InternalAnalyzer analyzer(effects);
+    analyzer.known = &walked;
+    analyzer.walk(curr);
+    effects.post();
+    if (walked.nested && walked.size >= MinSize) {
+      cache.emplace(curr, Entry{effects, walked.size});
+      // The first expression is the one we walked from.
+      for (Index i = 1; i < walked.list.size(); i++) {
+        owners[walked.list[i]] = curr;
+      }
+    }
+    queried.insert(curr);
+    queriedIds.set(curr->_id);
+    return effects;
+  }
+
+  // Notes that an expression was modified or replaced.
+  void invalidate(Expression* curr) {
+    cache.erase(curr);
+    while (true) {
+      auto iter = owners.find(curr);
+      if (iter == owners.end()) {
+        return;
+      }
+      curr = iter->second;
+      // If the owner was already invalidated, then so were its owners.
+      if (!cache.erase(curr)) {
+        return;
+      }
+    }
+  }
+
+  void clear() {
+    cache.clear();
+    owners.clear();
+    queried.clear();
+    queriedIds.reset();
+  }
+
+private:
+  const PassOptions& passOptions;
+  Module& module;
+
+  struct Entry {
+    EffectAnalyzer effects;
+    // The number of expressions in it.
+    Index size;
+  };
+
+  std::unordered_map<Expression*, Entry> cache;
+
+  // For each expression in a cached expression, the innermost cached
+  // expression that contains it. The walk that computed that cached expression
+  // reached this expression, either walking it or using its cached effects.
+  std::unordered_map<Expression*, Expression*> owners;
+
+  // The expressions we were asked about, and their ids. Only expressions with
+  // those ids need to be looked up during a walk.
+  std::unordered_set<Expression*> queried;
+  std::bitset<Expression::NumExpressionIds> queriedIds;
+
+  // Provides the cached effects during a walk, and notes what it reaches.
+  struct Walked : public EffectAnalyzer::KnownEffects {
+    EffectCache& parent;
+
+    // The expressions the walk reached, and how many expressions they contain
+    // in total.
+    std::vector<Expression*> list;
+    Index size = 0;
+
+    // Whether the walk reached an expression we were asked about before.
+    bool nested = false;
+
+    Walked(EffectCache& parent) : parent(parent) {}
+
+    const EffectAnalyzer* get(Expression* curr) override {
+      list.push_back(curr);
+      if (parent.queriedIds[curr->_id] && parent.queried.count(curr)) {
+        nested = true;
+        auto iter = parent.cache.find(curr);
+        if (iter != parent.cache.end()) {
+          size += iter->second.size;
+          return &iter->second.effects;
+        }
+      }
+      size++;
+      return nullptr;
+    }
+  };
+
+  // This is a member so that its list is not reallocated for each walk.
+  Walked walked{*this};
+};
+
+} // namespace wasm
+
+#endif // wasm_ir_effect_cache_h
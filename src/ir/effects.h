@@ -19,6 +19,8 @@
 
 #include "ir/intrinsics.h"
 #include "pass.h"
+#include "support/small_index_set.h"
+#include "support/small_set.h"
 #include "wasm-traversal.h"
 
 namespace wasm {
@@ -91,10 +93,12 @@ public:
   // of control flow proceeding normally).
   bool branchesOut = false;
   bool calls = false;
-  std::set<Index> localsRead;
-  std::set<Index> localsWritten;
-  std::set<Name> mutableGlobalsRead;
-  std::set<Name> globalsWritten;
+  // These sets are usually very small, and analyzers are created very often,
+  // so they avoid allocating until they grow.
+  SmallIndexSet<4> localsRead;
+  SmallIndexSet<4> localsWritten;
+  SmallSet<Name, 4> mutableGlobalsRead;
+  SmallSet<Name, 4> globalsWritten;
   bool readsMemory = false;
   bool writesMemory = false;
   bool readsTable = false;
@@ -242,15 +246,10 @@ public:
         (other.isAtomic && accessesMemory())) {
       return true;
     }
-    for (auto local : localsWritten) {
-      if (other.localsRead.count(local) || other.localsWritten.count(local)) {
-        return true;
-      }
-    }
-    for (auto local : localsRead) {
-      if (other.localsWritten.count(local)) {
-        return true;
-      }
+    if (localsWritten.intersects(other.localsRead) ||
+        localsWritten.intersects(other.localsWritten) ||
+        localsRead.intersects(other.localsWritten)) {
+      return true;
     }
     if ((other.calls && accessesMutableGlobal()) ||
         (calls && other.accessesMutableGlobal())) {
@@ -304,12 +303,8 @@ public:
     isAtomic = isAtomic || other.isAtomic;
     throws_ = throws_ || other.throws_;
     danglingPop = danglingPop || other.danglingPop;
-    for (auto i : other.localsRead) {
-      localsRead.insert(i);
-    }
-    for (auto i : other.localsWritten) {
-      localsWritten.insert(i);
-    }
+    localsRead.insert(other.localsRead);
+    localsWritten.insert(other.localsWritten);
     for (auto i : other.mutableGlobalsRead) {
       mutableGlobalsRead.insert(i);
     }
@@ -343,19 +338,39 @@ public:
     return hasAnything();
   }
 
-  std::set<Name> breakTargets;
-  std::set<Name> delegateTargets;
+  SmallSet<Name, 4> breakTargets;
+  SmallSet<Name, 4> delegateTargets;
 
 private:
+  friend class EffectCache;
+
+  // Provides the effects of some of the expressions in a walk, which are then
+  // merged in rather than walked into. This is used by EffectCache.
+  struct KnownEffects {
+    virtual ~KnownEffects() = default;
+
+    // Called on each expression that the walk reaches. Returns null if the
+    // effects of the expression are not known.
+    virtual const EffectAnalyzer* get(Expression* curr) = 0;
+  };
+
   struct InternalAnalyzer
     : public PostWalker<InternalAnalyzer, OverriddenVisitor<InternalAnalyzer>> {
 
     EffectAnalyzer& parent;
 
+    KnownEffects* known = nullptr;
+
     InternalAnalyzer(EffectAnalyzer& parent) : parent(parent) {}
 
     static void scan(InternalAnalyzer* self, Expression** currp) {
       Expression* curr = *currp;
+      if (self->known) {
+        if (auto* effects = self->known->get(curr)) {
+          self->mergeKnown(*effects);
+          return;
+        }
+      }
       // We need to decrement try depth before catch starts, so handle it
       // separately
       if (curr->is<Try>()) {
@@ -411,6 +426,21 @@ private:
       self->parent.catchDepth--;
     }
 
+    // Merges in the effects of an expression as if we had walked it here.
+    void mergeKnown(const EffectAnalyzer& effects) {
+      auto throws = parent.throws_;
+      auto danglingPop = parent.danglingPop;
+      parent.mergeIn(effects);
+      // Throws are caught by an enclosing catch_all, and pops in a catch are
+      // not dangling, just like in the walk.
+      if (parent.tryDepth > 0) {
+        parent.throws_ = throws;
+      }
+      if (parent.catchDepth > 0) {
+        parent.danglingPop = danglingPop;
+      }
+    }
+
     void visitBlock(Block* curr) {
       if (curr->name.is()) {
         parent.breakTargets.erase(curr->name); // these were internal breaks
@@ -418,7 +448,8 @@ private:
     }
     void visitIf(If* curr) {}
     void visitLoop(Loop* curr) {
-      if (curr->name.is() && parent.breakTargets.erase(curr->name) > 0) {
+      if (curr->name.is() && parent.breakTargets.count(curr->name)) {
+        parent.breakTargets.erase(curr->name);
         // Breaks to this loop exist, which we just removed as they do not have
         // further effect outside of this loop. One additional thing we need to
         // take into account is infinite looping, which is a noticeable side
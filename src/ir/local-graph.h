@@ -17,11 +17,17 @@
 #ifndef wasm_ir_local_graph_h
 #define wasm_ir_local_graph_h
 
-#include "support/small_set.h"
+#include <memory>
+
+#include "support/flat_multimap.h"
 #include "wasm.h"
 
 namespace wasm {
 
+namespace LocalGraphInternal {
+struct Flower;
+} // namespace LocalGraphInternal
+
 //
 // Finds the connections between local.gets and local.sets, creating
 // a graph of those ties. This is useful for "ssa-style" optimization,
@@ -30,23 +36,58 @@ namespace wasm {
 // (see the SSA pass for actually creating new local indexes based
 // on this).
 //
+// The results are computed by numbering the sets densely and solving reaching
+// definitions with bitsets, and are stored in flat arrays. They are read-only
+// once computed.
+//
+// A lazy LocalGraph instead finds the sets of a get only when they are asked
+// for, which is much faster when only a few gets matter in a large function.
+//
 struct LocalGraph {
   // main API
 
-  // the constructor computes getSetses, the sets affecting each get
-  LocalGraph(Function* func);
+  enum Mode { Eager, Lazy };
+
+  // the constructor computes getSetses, the sets affecting each get, unless we
+  // are lazy
+  LocalGraph(Function* func, Mode mode = Eager);
+
+  // The local.sets relevant for a get. Gets that are not reachable have none.
+  using Sets = FlatMultimap<LocalGet*, LocalSet*>::Values;
+
+  class GetSetses {
+  public:
+    using const_iterator = FlatMultimap<LocalGet*, LocalSet*>::const_iterator;
+
+    GetSetses();
+    ~GetSetses();
+
+    // When lazy, the sets of a get are found by flowing back from it through
+    // the CFG the first time they are asked for. Iterating computes those of
+    // all the gets at once.
+    const Sets& operator[](LocalGet* get);
+
+    const_iterator begin();
+    const_iterator end();
+    size_t size();
+
+  private:
+    friend struct LocalGraph;
+
+    FlatMultimap<LocalGet*, LocalSet*> all;
+    bool computedAll = false;
 
-  // The local.sets relevant for an index or a get. The most common case is to
-  // have a single set; after that, to be a phi of 2 items, so we use a small
-  // set of size 2 to avoid allocations there.
-  using Sets = SmallSet<LocalSet*, 2>;
+    // The CFG, while we are lazy.
+    std::unique_ptr<LocalGraphInternal::Flower> flower;
 
-  using GetSetses = std::unordered_map<LocalGet*, Sets>;
+    void computeAll();
+  };
 
-  using Locations = std::map<Expression*, Expression**>;
+  using Locations = std::unordered_map<Expression*, Expression**>;
 
   // externally useful information
-  GetSetses getSetses; // the sets affecting each get. a nullptr set means the
+  GetSetses getSetses; // the sets affecting each get, ordered as the gets
+                       // appear in the function. a nullptr set means the
                        // initial value (0 for a var, the received value for a
                        // param)
   Locations locations; // where each get and set is (for easy replacing)
@@ -67,10 +108,12 @@ struct LocalGraph {
   }
 
   // for each get, the sets whose values are influenced by that get
-  using GetInfluences = std::unordered_set<LocalSet*>;
-  std::unordered_map<LocalGet*, GetInfluences> getInfluences;
-  using SetInfluences = std::unordered_set<LocalGet*>;
-  std::unordered_map<LocalSet*, SetInfluences> setInfluences;
+  FlatMultimap<LocalGet*, LocalSet*> getInfluences;
+  using GetInfluences = decltype(getInfluences)::Values;
+  // for each set, the gets that read it. the initial values (nullptr sets)
+  // are not included
+  FlatMultimap<LocalSet*, LocalGet*> setInfluences;
+  using SetInfluences = decltype(setInfluences)::Values;
 
   // Optional: Compute the local indexes that are SSA, in the sense of
   //  * a single set for all the gets for that local index
@@ -99,7 +142,7 @@ struct LocalGraph {
 
 private:
   Function* func;
-  std::set<Index> SSAIndexes;
+  std::vector<bool> SSAIndexes;
 };
 
 } // namespace wasm
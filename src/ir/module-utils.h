@@ -31,6 +31,8 @@ namespace wasm::ModuleUtils {
 // name of the function (otherwise the original name is copied).
 inline Function*
 copyFunction(Function* func, Module& out, Name newName = Name()) {
+  // The body may not have been decoded yet if it was read lazily.
+  func->materialize();
   auto ret = std::make_unique<Function>();
   ret->name = newName.is() ? newName : func->name;
   ret->type = func->type;
@@ -330,6 +332,14 @@ template<typename T> inline void iterDefinedFunctions(Module& wasm, T visitor) {
   }
 }
 
+// Decode the bodies of any functions that were read lazily. See
+// WasmBinaryBuilder::setLazyFunctionBodies.
+inline void materializeFunctions(Module& wasm) {
+  for (auto& func : wasm.functions) {
+    func->materialize();
+  }
+}
+
 template<typename T> inline void iterImportedTags(Module& wasm, T visitor) {
   for (auto& import : wasm.tags) {
     if (import->imported()) {
@@ -33,6 +33,36 @@ namespace wasm {
 class Literals;
 struct GCData;
 
+// A reference-counted handle to GC data, like a std::shared_ptr but without
+// atomic operations, which add up when every copy of a reference Literal
+// updates the count. GC data is created by an interpreter and is never shared
+// between threads, so it does not need them.
+class GCDataRef {
+  GCData* data = nullptr;
+
+public:
+  GCDataRef() = default;
+  GCDataRef(std::nullptr_t) {}
+  // Takes a new reference to the data.
+  explicit GCDataRef(GCData* data);
+  GCDataRef(const GCDataRef& other);
+  GCDataRef(GCDataRef&& other) noexcept : data(other.data) {
+    other.data = nullptr;
+  }
+  GCDataRef& operator=(GCDataRef other) {
+    std::swap(data, other.data);
+    return *this;
+  }
+  ~GCDataRef();
+
+  GCData* get() const { return data; }
+  GCData* operator->() const { return data; }
+  GCData& operator*() const { return *data; }
+  explicit operator bool() const { return data; }
+  bool operator==(const GCDataRef& other) const { return data == other.data; }
+  bool operator!=(const GCDataRef& other) const { return data != other.data; }
+};
+
 class Literal {
   // store only integers, whose bits are deterministic. floats
   // can have their signalling bit set, for example.
@@ -49,7 +79,7 @@ class Literal {
     // we store the referred data as a Literals object (which is natural for an
     // Array, and for a Struct, is just the fields in order). The type is used
     // to indicate whether this is a Struct or an Array, and of what type.
-    std::shared_ptr<GCData> gcData;
+    GCDataRef gcData;
     // TODO: Literals of type `anyref` can only be `null` currently but we
     // will need to represent external values eventually, to
     // 1) run the spec tests and fuzzer with reference types enabled and
@@ -82,9 +112,11 @@ public:
     : func(func), type(type, NonNullable) {
     assert(type.isSignature());
   }
-  explicit Literal(std::shared_ptr<GCData> gcData, HeapType type);
+  explicit Literal(GCDataRef gcData, HeapType type);
   Literal(const Literal& other);
+  Literal(Literal&& other) noexcept;
   Literal& operator=(const Literal& other);
+  Literal& operator=(Literal&& other) noexcept;
   ~Literal();
 
   bool isConcrete() const { return type.isConcrete(); }
@@ -296,7 +328,7 @@ public:
     assert(type.isFunction() && !func.isNull());
     return func;
   }
-  std::shared_ptr<GCData> getGCData() const;
+  const GCDataRef& getGCData() const;
 
   // careful!
   int32_t* geti32Ptr() {
@@ -718,9 +750,41 @@ struct GCData {
   // The element or field values.
   Literals values;
 
-  GCData(HeapType type, Literals values) : type(type), values(values) {}
+  GCData(HeapType type, Literals values)
+    : type(type), values(std::move(values)) {}
+
+  // Copying the data does not copy the references to it.
+  GCData(const GCData& other) : type(other.type), values(other.values) {}
+  GCData& operator=(const GCData& other) {
+    type = other.type;
+    values = other.values;
+    return *this;
+  }
+
+private:
+  friend class GCDataRef;
+
+  size_t refCount = 0;
 };
 
+inline GCDataRef::GCDataRef(GCData* data) : data(data) {
+  if (data) {
+    data->refCount++;
+  }
+}
+
+inline GCDataRef::GCDataRef(const GCDataRef& other) : GCDataRef(other.data) {}
+
+inline GCDataRef::~GCDataRef() {
+  if (data && --data->refCount == 0) {
+    delete data;
+  }
+}
+
+template<typename... Args> GCDataRef makeGCData(Args&&... args) {
+  return GCDataRef(new GCData(std::forward<Args>(args)...));
+}
+
 } // namespace wasm
 
 namespace std {
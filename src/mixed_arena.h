@@ -70,6 +70,11 @@ struct MixedArena {
 
   size_t index = 0; // in last chunk
 
+  // The total size of the chunks allocated by all arenas so far. This is only
+  // updated when a new chunk is allocated, so it is cheap to maintain, and it
+  // is useful for profiling how much memory passes allocate.
+  static inline std::atomic<size_t> totalChunkBytes{0};
+
   std::thread::id threadId;
 
   // multithreaded allocation - each arena is valid on a specific thread.
@@ -129,6 +134,8 @@ struct MixedArena {
       if (!allocation) {
         abort();
       }
+      totalChunkBytes.fetch_add(numChunks * CHUNK_SIZE,
+                                std::memory_order_relaxed);
       chunks.push_back(allocation);
       index = 0;
     }
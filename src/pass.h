@@ -93,6 +93,14 @@ struct InliningOptions {
   // TODO: Investigate enabling this. Locally 4 appears useful on real-world
   //       code, but reports of regressions have arrived.
   Index partialInliningIfs = 0;
+  // Whether to inline in a single pass over the call graph, from callees to
+  // callers, instead of iterating to a fixed point. The module is scanned only
+  // once, which keeps compile times predictable on very large modules.
+  bool bottomUp = false;
+  // The maximum growth in total code size that inlining may cause in bottom-up
+  // mode, as a percentage of the original size. Inlining functions that are
+  // always inlined, or whose only caller this is, does not count towards it.
+  Index maxCodeGrowth = 100;
 };
 
 // Forward declaration for FuncEffectsMap.
@@ -228,6 +236,10 @@ struct PassOptions {
   std::unordered_map<std::string, std::string> arguments;
   // Passes to skip and not run.
   std::unordered_set<std::string> passesToSkip;
+  // A directory in which to cache the results of function-parallel passes on
+  // each function, so that unchanged functions need not be optimized again.
+  // See passes/function-cache.h.
+  std::string functionCache;
 
   // Effect info computed for functions. One pass can generate this and then
   // other passes later can benefit from it. It is up to the sequence of passes
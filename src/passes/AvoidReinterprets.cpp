@@ -92,8 +92,8 @@ struct AvoidReinterprets : public WalkerPass<PostWalker<AvoidReinterprets>> {
   LocalGraph* localGraph;
 
   void doWalkFunction(Function* func) {
-    // prepare
-    LocalGraph localGraph_(func);
+    // prepare. we only look at the gets of reinterprets, so be lazy
+    LocalGraph localGraph_(func, LocalGraph::Lazy);
     localGraph = &localGraph_;
     // walk
     PostWalker<AvoidReinterprets>::doWalkFunction(func);
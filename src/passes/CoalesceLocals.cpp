@@ -27,6 +27,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "cfg/liveness-traversal.h"
@@ -35,7 +36,7 @@
 #include "pass.h"
 #include "support/learning.h"
 #include "support/permutations.h"
-#include "support/sparse_square_matrix.h"
+#include "support/triangular_bit_matrix.h"
 #include "wasm.h"
 #ifdef CFG_PROFILE
 #include "support/timing.h"
@@ -62,9 +63,12 @@ struct CoalesceLocals
   void increaseBackEdgePriorities();
 
   // Calculate interferences between locals. This will will fill
-  // the data structure |interferences|.
+  // the data structures |interferences| and |interferenceLists|.
   void calculateInterferences();
 
+  // Fill |copyLists| from the copies we noted.
+  void calculateCopyLists();
+
   void pickIndicesFromOrder(std::vector<Index>& order,
                             std::vector<Index>& indices);
   void pickIndicesFromOrder(std::vector<Index>& order,
@@ -79,27 +83,72 @@ struct CoalesceLocals
   // interference state
 
   // canonicalized - accesses should check (low, high)
-  sparse_square_matrix<bool> interferences;
+  TriangularBitMatrix interferences;
+  size_t numInterferences;
 
   void interfere(Index i, Index j) {
     if (i == j) {
       return;
     }
-    interferences.set(std::min(i, j), std::max(i, j), true);
+    interfereLowHigh(std::min(i, j), std::max(i, j));
   }
 
   // optimized version where you know that low < high
   void interfereLowHigh(Index low, Index high) {
-    assert(low < high);
-    interferences.set(low, high, true);
+    if (interferences.set(low, high)) {
+      numInterferences++;
+    }
   }
 
-  void unInterfere(Index i, Index j) {
-    interferences.set(std::min(i, j), std::max(i, j), false);
+  bool interferes(Index i, Index j) {
+    return i != j && interferences.get(std::min(i, j), std::max(i, j));
   }
 
-  bool interferes(Index i, Index j) {
-    return interferences.get(std::min(i, j), std::max(i, j));
+  // For each local, a list of other locals, stored contiguously.
+  struct LocalLists {
+    std::vector<size_t> starts;
+    std::vector<Index> items;
+
+    // Builds symmetric lists from pairs of locals, given a function that calls
+    // its argument on each pair. The order of the pairs does not matter.
+    template<typename F> void build(Index numLocals, F forEachPair) {
+      starts.assign(numLocals + 1, 0);
+      forEachPair([&](Index i, Index j) {
+        starts[i + 1]++;
+        starts[j + 1]++;
+      });
+      for (Index i = 0; i < numLocals; i++) {
+        starts[i + 1] += starts[i];
+      }
+      items.resize(starts[numLocals]);
+      auto positions = starts;
+      forEachPair([&](Index i, Index j) {
+        items[positions[i]++] = j;
+        items[positions[j]++] = i;
+      });
+    }
+
+    const Index* begin(Index i) const { return items.data() + starts[i]; }
+    const Index* end(Index i) const { return items.data() + starts[i + 1]; }
+  };
+
+  // The locals each local interferes with, and has copies with. These let us
+  // pick indices in time proportional to the number of interferences and
+  // copies, rather than to the square of the number of locals. Interference
+  // graphs can be very dense, however, so above a certain size we do not
+  // build lists for them, and scan the matrix instead.
+  static const size_t MaxInterferenceLists = size_t(1) << 25;
+
+  bool useInterferenceLists;
+  LocalLists interferenceLists;
+  LocalLists copyLists;
+
+  template<typename F> void forEachInterference(Index i, F f) {
+    if (useInterferenceLists) {
+      std::for_each(interferenceLists.begin(i), interferenceLists.end(i), f);
+    } else {
+      interferences.forEachInRow(i, f);
+    }
   }
 };
 
@@ -109,6 +158,7 @@ void CoalesceLocals::doWalkFunction(Function* func) {
   increaseBackEdgePriorities();
   // use liveness to find interference
   calculateInterferences();
+  calculateCopyLists();
   // pick new indices
   std::vector<Index> indices;
   pickIndices(indices);
@@ -146,6 +196,7 @@ void CoalesceLocals::increaseBackEdgePriorities() {
 
 void CoalesceLocals::calculateInterferences() {
   interferences.recreate(numLocals);
+  numInterferences = 0;
 
   // We will track the values in each local, using a numbering where each index
   // represents a unique different value. This array maps a local index to the
@@ -327,6 +378,24 @@ void CoalesceLocals::calculateInterferences() {
       }
     }
   }
+
+  useInterferenceLists = numInterferences <= MaxInterferenceLists;
+  if (useInterferenceLists) {
+    interferenceLists.build(numLocals,
+                            [&](auto f) { interferences.forEach(f); });
+  } else {
+    interferenceLists = {};
+  }
+}
+
+void CoalesceLocals::calculateCopyLists() {
+  copyLists.build(numLocals, [&](auto f) {
+    for (auto& [pair, count] : copies) {
+      if (pair.first != pair.second) {
+        f(pair.first, pair.second);
+      }
+    }
+  });
 }
 
 // Indices decision making
@@ -375,20 +444,27 @@ void CoalesceLocals::pickIndicesFromOrder(std::vector<Index>& order,
 #endif
   // TODO: take into account distribution (99-1 is better than 50-50 with two
   // registers, for gzip)
-  std::vector<Type> types;
-  // new index * numLocals => list of all interferences of locals merged to it
-  sparse_square_matrix<bool> newInterferences;
-
-  // new index * numLocals => list of all copies of locals merged to it
-  sparse_square_matrix<uint8_t> newCopies;
-
+  auto* func = getFunction();
   indices.resize(numLocals);
-  types.resize(numLocals);
-
-  auto numParams = getFunction()->getNumParams();
-
-  newInterferences.recreate(numLocals);
-  newCopies.recreate(numLocals);
+  // The locals before the current one in the order have been assigned their
+  // new indices, and only those matter when picking for the current one.
+  std::vector<Index> positions(numLocals);
+  for (Index i = 0; i < numLocals; i++) {
+    positions[order[i]] = i;
+  }
+  // new index => its type
+  std::vector<Type> types(numLocals);
+  // type => the new indices of that type, in increasing order
+  std::unordered_map<Type, std::vector<Index>> typeIndices;
+  // new index => the position in the order of the last local that interferes
+  // with a local merged to it, which means that local cannot be merged to it
+  std::vector<Index> excluded(numLocals, Index(-1));
+  // new index => copies between the current local and the locals merged to it,
+  // for the new indices in |copyIndices|
+  std::vector<uint8_t> newCopies(numLocals);
+  std::vector<Index> copyIndices;
+
+  auto numParams = func->getNumParams();
 
   Index nextFree = 0;
   removedCopies = 0;
@@ -397,50 +473,64 @@ void CoalesceLocals::pickIndicesFromOrder(std::vector<Index>& order,
   for (; i < numParams; i++) {
     assert(order[i] == i); // order must leave the params in place
     indices[i] = i;
-    types[i] = getFunction()->getLocalType(i);
-    for (Index j = numParams; j < numLocals; j++) {
-      newInterferences.set(i, j, interferes(i, j));
-      newCopies.set(i, j, getCopies(i, j));
-    }
+    types[i] = func->getLocalType(i);
+    typeIndices[types[i]].push_back(i);
     nextFree++;
   }
   for (; i < numLocals; i++) {
     Index actual = order[i];
+    auto type = func->getLocalType(actual);
+    forEachInterference(actual, [&](Index other) {
+      if (positions[other] < i) {
+        excluded[indices[other]] = i;
+      }
+    });
+    for (auto* other = copyLists.begin(actual); other != copyLists.end(actual);
+         other++) {
+      if (positions[*other] < i) {
+        auto index = indices[*other];
+        newCopies[index] += getCopies(actual, *other);
+        copyIndices.push_back(index);
+      }
+    }
+    // Pick the index that does not interfere and eliminates the most copies,
+    // or the first one that does not interfere if none eliminate any.
     Index found = -1;
-    uint8_t foundCopies = -1;
-    for (Index j = 0; j < nextFree; j++) {
-      if (!newInterferences.get(j, actual) &&
-          getFunction()->getLocalType(actual) == types[j]) {
-        // this does not interfere, so it might be what we want. but pick the
-        // one eliminating the most copies (we could stop looking forward when
-        // there are no more items that have copies anyhow, but it doesn't seem
-        // to help)
-        auto currCopies = newCopies.get(j, actual);
-        if (found == Index(-1) || currCopies > foundCopies) {
-          indices[actual] = found = j;
-          foundCopies = currCopies;
+    uint8_t foundCopies = 0;
+    for (auto index : copyIndices) {
+      auto currCopies = newCopies[index];
+      if (excluded[index] != i && types[index] == type && currCopies > 0 &&
+          (currCopies > foundCopies ||
+           (currCopies == foundCopies && index < found))) {
+        found = index;
+        foundCopies = currCopies;
+      }
+    }
+    if (found == Index(-1)) {
+      for (auto index : typeIndices[type]) {
+        if (excluded[index] != i) {
+          found = index;
+          break;
         }
       }
     }
+    for (auto index : copyIndices) {
+      newCopies[index] = 0;
+    }
+    copyIndices.clear();
     if (found == Index(-1)) {
       indices[actual] = found = nextFree;
-      types[found] = getFunction()->getLocalType(actual);
+      types[found] = type;
+      typeIndices[type].push_back(found);
       nextFree++;
       removedCopies += getCopies(found, actual);
     } else {
+      indices[actual] = found;
       removedCopies += foundCopies;
     }
 #if CFG_DEBUG
     std::cerr << "set local $" << actual << " to $" << found << '\n';
 #endif
-    // merge new interferences and copies for the new index
-    for (Index k = i + 1; k < numLocals; k++) {
-      // go in the order, we only need to update for those we will see later
-      auto j = order[k];
-      newInterferences.set(
-        found, j, newInterferences.get(found, j) || interferes(actual, j));
-      newCopies.set(found, j, newCopies.get(found, j) + getCopies(actual, j));
-    }
   }
 }
 
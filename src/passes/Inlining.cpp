@@ -417,6 +417,37 @@ static Expression* doInlining(Module* module,
   return block;
 }
 
+// Performs the inlinings that were chosen for each function. A function that
+// is inlined into is not itself inlined in the same iteration, so the work on
+// each function is independent of the others, and we can do it in parallel.
+struct Inliner : public Pass {
+  bool isFunctionParallel() override { return true; }
+
+  Inliner(InliningState* state) : state(state) {}
+
+  std::unique_ptr<Pass> create() override {
+    return std::make_unique<Inliner>(state);
+  }
+
+  // doInlining() fixes up the functions it modifies.
+  bool requiresNonNullableLocalFixups() override { return false; }
+
+  void runOnFunction(Module* module, Function* func) override {
+    auto iter = state->actionsForFunction.find(func->name);
+    if (iter == state->actionsForFunction.end() || iter->second.empty()) {
+      return;
+    }
+    for (auto& action : iter->second) {
+      doInlining(module, func, action, getPassOptions());
+    }
+    // Anything we inlined into may now have non-unique label names, fix it up.
+    wasm::UniqueNameMapper::uniquify(func->body);
+  }
+
+private:
+  InliningState* state;
+};
+
 //
 // Function splitting / partial inlining / inlining of conditions.
 //
@@ -870,6 +901,11 @@ struct Inlining : public Pass {
   void run(Module* module_) override {
     module = module_;
 
+    if (getPassOptions().inlining.bottomUp) {
+      runBottomUp();
+      return;
+    }
+
     // No point to do more iterations than the number of functions, as it means
     // we are infinitely recursing (which should be very rare in practice, but
     // it is possible that a recursive call can look like it is worth inlining).
@@ -993,19 +1029,24 @@ struct Inlining : public Pass {
     }
     // find and plan inlinings
     Planner(&state).run(getPassRunner(), module);
-    // perform inlinings TODO: parallelize
+    // Choose the inlinings to perform. Whether we can perform one depends on
+    // the ones chosen before it, so this is done serially, in a deterministic
+    // order. We keep only the chosen actions, and perform them later.
     std::unordered_map<Name, Index> inlinedUses; // how many uses we inlined
     // which functions were inlined into
     for (auto name : funcNames) {
       auto* func = module->getFunction(name);
+      auto& actions = state.actionsForFunction[name];
       // if we've inlined a function, don't inline into it in this iteration,
       // avoid risk of races
       // note that we do not risk stalling progress, as each iteration() will
       // inline at least one call before hitting this
       if (inlinedUses.count(func->name)) {
+        actions.clear();
         continue;
       }
-      for (auto& action : state.actionsForFunction[name]) {
+      std::vector<InliningAction> chosen;
+      for (auto& action : actions) {
         auto* inlinedFunction = action.contents;
         // if we've inlined into a function, don't inline it in this iteration,
         // avoid risk of races
@@ -1032,17 +1073,20 @@ struct Inlining : public Pass {
         // note that we got rid of one use of the original function).
         action.contents = getActuallyInlinedFunction(action.contents);
 
-        // Perform the inlining and update counts.
-        doInlining(module, func, action, getPassOptions());
+        // Update counts for the inlining we will perform.
+        chosen.push_back(action);
         inlinedUses[inlinedName]++;
         inlinedInto.insert(func);
         assert(inlinedUses[inlinedName] <= infos[inlinedName].refs);
       }
+      actions = std::move(chosen);
     }
-    for (auto func : inlinedInto) {
-      // Anything we inlined into may now have non-unique label names, fix it
-      // up.
-      wasm::UniqueNameMapper::uniquify(func->body);
+    // Perform the inlinings. The functions we inline from are not modified in
+    // this iteration, so this has the same result as doing them in order.
+    if (!inlinedInto.empty()) {
+      PassRunner runner(getPassRunner());
+      runner.add(std::make_unique<Inliner>(&state));
+      runner.run();
     }
     if (optimize && inlinedInto.size() > 0) {
       OptUtils::optimizeAfterInlining(inlinedInto, module, getPassRunner());
@@ -1056,6 +1100,187 @@ struct Inlining : public Pass {
     });
   }
 
+  // Inlines in a single pass over the call graph (InliningOptions::bottomUp).
+  // The functions are processed in layers, where each function is in a later
+  // layer than the functions it may inline, so that we inline a function only
+  // after we are done inlining into it and optimizing it. The functions in a
+  // layer are independent of each other, so we handle each layer in parallel.
+  void runBottomUp() {
+    prepare();
+    auto& options = getPassOptions();
+
+    InliningState state;
+    std::vector<Function*> funcs;
+    std::unordered_map<Function*, Index> funcIndexes;
+    uint64_t totalSize = 0;
+    for (auto& func : module->functions) {
+      state.actionsForFunction[func->name];
+      if (func->imported()) {
+        continue;
+      }
+      if (infos[func->name].worthInlining(options)) {
+        state.worthInlining.insert(func->name);
+      }
+      funcIndexes[func.get()] = funcs.size();
+      funcs.push_back(func.get());
+      totalSize += infos[func->name].size;
+    }
+    if (state.worthInlining.empty()) {
+      return;
+    }
+    Planner(&state).run(getPassRunner(), module);
+
+    // Find the strongly connected components of the graph of the calls we may
+    // inline, using Tarjan's algorithm. Each component is found after all the
+    // components it calls into.
+    Index numFuncs = funcs.size();
+    std::vector<std::vector<Index>> callees(numFuncs);
+    for (Index i = 0; i < numFuncs; i++) {
+      for (auto& action : state.actionsForFunction[funcs[i]->name]) {
+        callees[i].push_back(funcIndexes[action.contents]);
+      }
+    }
+    const Index Unvisited = -1;
+    std::vector<Index> visitIndexes(numFuncs, Unvisited);
+    std::vector<Index> lowLinks(numFuncs);
+    std::vector<Index> components(numFuncs);
+    std::vector<bool> onStack(numFuncs);
+    std::vector<Index> stack;
+    // The functions we are visiting, and the next callee of each to look at.
+    std::vector<std::pair<Index, Index>> work;
+    Index nextVisitIndex = 0;
+    Index numComponents = 0;
+    auto visit = [&](Index i) {
+      visitIndexes[i] = lowLinks[i] = nextVisitIndex++;
+      stack.push_back(i);
+      onStack[i] = true;
+      work.emplace_back(i, 0);
+    };
+    for (Index root = 0; root < numFuncs; root++) {
+      if (visitIndexes[root] != Unvisited) {
+        continue;
+      }
+      visit(root);
+      while (!work.empty()) {
+        auto [i, next] = work.back();
+        if (next < callees[i].size()) {
+          work.back().second++;
+          auto callee = callees[i][next];
+          if (visitIndexes[callee] == Unvisited) {
+            visit(callee);
+          } else if (onStack[callee]) {
+            lowLinks[i] = std::min(lowLinks[i], visitIndexes[callee]);
+          }
+          continue;
+        }
+        work.pop_back();
+        if (!work.empty()) {
+          auto caller = work.back().first;
+          lowLinks[caller] = std::min(lowLinks[caller], lowLinks[i]);
+        }
+        if (lowLinks[i] == visitIndexes[i]) {
+          Index member;
+          do {
+            member = stack.back();
+            stack.pop_back();
+            onStack[member] = false;
+            components[member] = numComponents;
+          } while (member != i);
+          numComponents++;
+        }
+      }
+    }
+
+    // A component's layer is one more than the latest layer it calls into.
+    // Calls within a component are never inlined, as that could recurse.
+    std::vector<std::vector<Index>> members(numComponents);
+    for (Index i = 0; i < numFuncs; i++) {
+      members[components[i]].push_back(i);
+    }
+    std::vector<Index> componentLayers(numComponents, 0);
+    std::vector<std::vector<Function*>> layers;
+    for (Index component = 0; component < numComponents; component++) {
+      auto& layer = componentLayers[component];
+      for (auto i : members[component]) {
+        for (auto callee : callees[i]) {
+          if (components[callee] != component) {
+            layer = std::max(layer, componentLayers[components[callee]] + 1);
+          }
+        }
+      }
+      if (layer >= layers.size()) {
+        layers.resize(layer + 1);
+      }
+    }
+    for (Index i = 0; i < numFuncs; i++) {
+      layers[componentLayers[components[i]]].push_back(funcs[i]);
+    }
+
+    auto budget = totalSize * options.inlining.maxCodeGrowth / 100;
+    uint64_t growth = 0;
+    std::unordered_map<Name, Index> inlinedUses; // how many uses we inlined
+    for (auto& layer : layers) {
+      // Choose the inlinings to perform in this layer, in a deterministic
+      // order, as they share the budget. Sizes are up to date, as the callees
+      // were all handled in earlier layers.
+      InliningState layerState;
+      std::unordered_set<Function*> inlinedInto;
+      for (auto* func : layer) {
+        auto index = funcIndexes[func];
+        auto& chosen = layerState.actionsForFunction[func->name];
+        for (auto& action : state.actionsForFunction[func->name]) {
+          auto* inlined = action.contents;
+          auto& info = infos[inlined->name];
+          if (components[funcIndexes[inlined]] == components[index] ||
+              !info.worthInlining(options) ||
+              !isUnderSizeLimit(func->name, inlined->name)) {
+            continue;
+          }
+          bool free = info.size <= options.inlining.alwaysInlineMaxSize ||
+                      (info.refs == 1 && !info.usedGlobally);
+          if (!free) {
+            if (growth + info.size > budget) {
+              continue;
+            }
+            growth += info.size;
+          }
+#ifdef INLINING_DEBUG
+          std::cout << "inline " << inlined->name << " into " << func->name
+                    << '\n';
+#endif
+          chosen.push_back(action);
+          inlinedUses[inlined->name]++;
+          infos[func->name].size += info.size;
+          inlinedInto.insert(func);
+        }
+      }
+      if (inlinedInto.empty()) {
+        continue;
+      }
+      {
+        PassRunner runner(getPassRunner());
+        runner.add(std::make_unique<Inliner>(&layerState));
+        runner.run();
+      }
+      if (optimize) {
+        OptUtils::optimizeAfterInlining(inlinedInto, module, getPassRunner());
+      }
+      for (auto* func : inlinedInto) {
+        EHUtils::handleBlockNestedPops(func, *module);
+        // Update the size, rather than rescan the module.
+        infos[func->name].size = Measurer::measure(func->body);
+      }
+    }
+
+    // remove functions that we no longer need after inlining
+    module->removeFunctions([&](Function* func) {
+      auto name = func->name;
+      auto& info = infos[name];
+      return inlinedUses.count(name) && inlinedUses[name] == info.refs &&
+             !info.usedGlobally;
+    });
+  }
+
   bool worthInlining(Name name) {
     // Check if the function itself is worth inlining as it is.
     if (infos[name].worthInlining(getPassOptions())) {
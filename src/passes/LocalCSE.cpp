@@ -117,6 +117,7 @@
 #include <memory>
 
 #include <ir/cost.h>
+#include <ir/effect-cache.h>
 #include <ir/effects.h>
 #include <ir/iteration.h>
 #include <ir/linear-execution.h>
@@ -354,8 +355,14 @@ struct Checker
   PassOptions& options;
   RequestInfoMap& requestInfos;
 
-  Checker(PassOptions& options, RequestInfoMap& requestInfos)
-    : options(options), requestInfos(requestInfos) {}
+  // Originals may be nested in each other, as in (A (B (C))) where all three
+  // are repeated, so cache effects to avoid walking C for each of them. We do
+  // not modify anything, so nothing needs to be invalidated.
+  EffectCache effectCache;
+
+  Checker(PassOptions& options, Module& module, RequestInfoMap& requestInfos)
+    : options(options), requestInfos(requestInfos),
+      effectCache(options, module) {}
 
   struct ActiveOriginalInfo {
     // How many of the requests remain to be seen during our walk. When this
@@ -419,7 +426,7 @@ struct Checker
     if (info.requests > 0) {
       // This is an original. Compute its side effects, as we cannot optimize
       // away repeated apperances if it has any.
-      EffectAnalyzer effects(options, *getModule(), curr);
+      EffectAnalyzer effects = effectCache.get(curr);
 
       // We can ignore traps here, as we replace a repeating expression with a
       // single appearance of it, a store to a local, and gets in the other
@@ -542,7 +549,7 @@ struct LocalCSE : public WalkerPass<PostWalker<LocalCSE>> {
       return;
     }
 
-    Checker checker(options, requestInfos);
+    Checker checker(options, *getModule(), requestInfos);
     checker.walkFunctionInModule(func, getModule());
     if (requestInfos.empty()) {
       // No repeated expressions remain after checking for effects.
@@ -48,8 +48,9 @@ struct LoopInvariantCodeMotion
   LocalGraph* localGraph;
 
   void doWalkFunction(Function* func) {
-    // Compute all local dependencies first.
-    LocalGraph localGraphInstance(func);
+    // We look at the local dependencies of the code we may move out of loops,
+    // which is usually a small part of the function, so compute them lazily.
+    LocalGraph localGraphInstance(func, LocalGraph::Lazy);
     localGraph = &localGraphInstance;
     // Traverse the function.
     super::doWalkFunction(func);
@@ -66,7 +66,24 @@ using GetValues = std::unordered_map<LocalGet*, Literals>;
 // representation, the merge will cause a local.get of $x to have more
 // possible input values than that struct.new, which means we will not infer
 // a value for it, and not attempt to say anything about comparisons of $x.
-using HeapValues = std::unordered_map<Expression*, std::shared_ptr<GCData>>;
+using HeapValues = std::unordered_map<Expression*, GCDataRef>;
+
+// The result of precomputing an expression that does not depend on anything
+// outside of it. Such an expression computes the same thing each time, both by
+// itself and as part of a parent, so we can remember the result rather than
+// compute it again for each parent, which would be quadratic in the depth of
+// the tree. That includes failing to compute it, which is the common case.
+struct CachedFlow {
+  Flow flow;
+  // Whether the expression was not constant, and we threw rather than
+  // returned a flow.
+  bool nonconstant = false;
+  // How deep the evaluation went. When we reuse it at a greater depth we may
+  // hit the depth limit.
+  Index depth = 0;
+};
+
+using FlowCache = std::unordered_map<Expression*, CachedFlow>;
 
 // Precomputes an expression. Errors if we hit anything that can't be
 // precomputed. Inherits most of its functionality from
@@ -83,6 +100,15 @@ class PrecomputingExpressionRunner
 
   HeapValues& heapValues;
 
+  FlowCache& flowCache;
+
+  // How many times we looked at the values of locals and globals. Expressions
+  // that do so depend on the context we evaluate them in, and are not cached.
+  Index contextReads = 0;
+
+  // The greatest depth we reached.
+  Index deepest = 0;
+
   // Limit evaluation depth for 2 reasons: first, it is highly unlikely
   // that we can do anything useful to precompute a hugely nested expression
   // (we should succed at smaller parts of it first). Second, a low limit is
@@ -99,6 +125,7 @@ public:
   PrecomputingExpressionRunner(Module* module,
                                GetValues& getValues,
                                HeapValues& heapValues,
+                               FlowCache& flowCache,
                                bool replaceExpression)
     : ConstantExpressionRunner<PrecomputingExpressionRunner>(
         module,
@@ -106,9 +133,69 @@ public:
                           : FlagValues::DEFAULT,
         MAX_DEPTH,
         MAX_LOOP_ITERATIONS),
-      getValues(getValues), heapValues(heapValues) {}
+      getValues(getValues), heapValues(heapValues), flowCache(flowCache) {}
+
+  // The runner visits every child through here, so the depths we note are the
+  // ones the runner reaches, and a cached result hits the depth limit exactly
+  // where computing it again would.
+  Flow visit(Expression* curr) {
+    auto start = depth;
+    auto iter = flowCache.find(curr);
+    if (iter != flowCache.end()) {
+      auto& cached = iter->second;
+      deepest = std::max(deepest, start + cached.depth);
+      if (start + cached.depth > maxDepth) {
+        hostLimit("interpreter recursion limit");
+      }
+      if (cached.nonconstant) {
+        throw NonconstantException();
+      }
+      return cached.flow;
+    }
+    frames.push_back({curr, start, deepest, contextReads});
+    deepest = start + 1;
+    auto flow = Super::visit(curr);
+    noteResult(flow, false);
+    return flow;
+  }
+
+  // The runner threw because something was not constant, so the expressions
+  // we were in the middle of are not constant either. Noting that here rather
+  // than catching and rethrowing at every level keeps the common failure
+  // cheap in deep trees.
+  void noteNonconstant() {
+    while (!frames.empty()) {
+      noteResult(Flow(), true);
+    }
+  }
+
+private:
+  // The expressions we are in the middle of visiting, and the state when we
+  // began each one.
+  struct Frame {
+    Expression* curr;
+    Index start;
+    Index oldDeepest;
+    Index oldContextReads;
+  };
+  std::vector<Frame> frames;
+
+  void noteResult(const Flow& flow, bool nonconstant) {
+    auto frame = frames.back();
+    frames.pop_back();
+    Index reached = deepest - frame.start;
+    deepest = std::max(frame.oldDeepest, deepest);
+    // Results that depend on the depth limit are not reusable at another depth,
+    // and leaves are cheap enough to compute again.
+    if (contextReads == frame.oldContextReads && reached > 1 &&
+        frame.start + reached <= maxDepth) {
+      flowCache[frame.curr] = CachedFlow{flow, nonconstant, reached};
+    }
+  }
 
+public:
   Flow visitLocalGet(LocalGet* curr) {
+    contextReads++;
     auto iter = getValues.find(curr);
     if (iter != getValues.end()) {
       auto values = iter->second;
@@ -120,6 +207,19 @@ public:
       PrecomputingExpressionRunner>::visitLocalGet(curr);
   }
 
+  Flow visitLocalSet(LocalSet* curr) {
+    contextReads++;
+    return Super::visitLocalSet(curr);
+  }
+  Flow visitGlobalGet(GlobalGet* curr) {
+    contextReads++;
+    return Super::visitGlobalGet(curr);
+  }
+  Flow visitGlobalSet(GlobalSet* curr) {
+    contextReads++;
+    return Super::visitGlobalSet(curr);
+  }
+
   // TODO: Use immutability for values
   Flow visitStructNew(StructNew* curr) {
     auto flow = Super::visitStructNew(curr);
@@ -183,10 +283,10 @@ public:
     // We must return a literal that refers to the canonical location for this
     // source expression, so that each time we compute a specific struct.new
     // we get the same identity.
-    std::shared_ptr<GCData>& canonical = heapValues[curr];
-    std::shared_ptr<GCData> newGCData = flow.getSingleValue().getGCData();
+    GCDataRef& canonical = heapValues[curr];
+    GCDataRef newGCData = flow.getSingleValue().getGCData();
     if (!canonical) {
-      canonical = std::make_shared<GCData>(*newGCData);
+      canonical = makeGCData(*newGCData);
     } else {
       *canonical = *newGCData;
     }
@@ -210,8 +310,14 @@ struct Precompute
   GetValues getValues;
   HeapValues heapValues;
 
+  // Cached results of the runner, when replacing expressions and when only
+  // computing their values, which the runner does with different flags.
+  FlowCache replacingFlowCache;
+  FlowCache valueFlowCache;
+
   void doWalkFunction(Function* func) {
     // Walk the function and precompute things.
+    clearFlowCaches();
     super::doWalkFunction(func);
     if (!propagate) {
       return;
@@ -220,11 +326,15 @@ struct Precompute
     // precompute the values from a local.set to a local.get. This populates
     // getValues which is then used by a subsequent walk that applies those
     // values.
+    // The walk refinalized the function, which may have changed the types of
+    // things we cached, so start afresh.
+    clearFlowCaches();
     bool propagated = propagateLocals(func);
     if (propagated) {
       // We found constants to propagate and entered them in getValues. Do
       // another walk to apply them and perhaps other optimizations that are
       // unlocked.
+      clearFlowCaches();
       super::doWalkFunction(func);
     }
     // Note that in principle even more cycles could find further work here, in
@@ -233,7 +343,23 @@ struct Precompute
     // --converge.
   }
 
+  void clearFlowCaches() {
+    replacingFlowCache.clear();
+    valueFlowCache.clear();
+  }
+
+  // Forgets what we computed for an expression we are about to modify in
+  // place. Its parents have not been computed yet, as we walk in post-order.
+  void noteModified(Expression* curr) {
+    replacingFlowCache.erase(curr);
+    valueFlowCache.erase(curr);
+  }
+
   template<typename T> void reuseConstantNode(T* curr, Flow flow) {
+    noteModified(curr);
+    if (curr->value) {
+      noteModified(curr->value);
+    }
     if (flow.values.isConcrete()) {
       // reuse a const / ref.null / ref.func node if there is one
       if (curr->value && flow.values.size() == 1) {
@@ -315,6 +441,7 @@ struct Precompute
     if (flow.values.isConcrete()) {
       replaceCurrent(flow.getConstExpression(*getModule()));
     } else {
+      noteModified(curr);
       ExpressionManipulator::nop(curr);
     }
   }
@@ -328,12 +455,17 @@ private:
   // Precompute an expression, returning a flow, which may be a constant
   // (that we can replace the expression with if replaceExpression is set).
   Flow precomputeExpression(Expression* curr, bool replaceExpression = true) {
+    PrecomputingExpressionRunner runner(
+      getModule(),
+      getValues,
+      heapValues,
+      replaceExpression ? replacingFlowCache : valueFlowCache,
+      replaceExpression);
     Flow flow;
     try {
-      flow = PrecomputingExpressionRunner(
-               getModule(), getValues, heapValues, replaceExpression)
-               .visit(curr);
+      flow = runner.visit(curr);
     } catch (PrecomputingExpressionRunner::NonconstantException&) {
+      runner.noteNonconstant();
       return Flow(NONCONSTANT_FLOW);
     }
     // If we are replacing the expression, then the resulting value must be of
@@ -3737,6 +3737,7 @@ std::ostream& printStackIR(std::ostream& o, Module* module, bool optimize) {
 namespace std {
 
 std::ostream& operator<<(std::ostream& o, wasm::Module& module) {
+  wasm::ModuleUtils::materializeFunctions(module);
   wasm::PassRunner runner(&module);
   wasm::Printer printer(&o);
   // Do not use runner.run(), since that will cause an infinite recursion in
@@ -46,8 +46,11 @@
 // removing redundant locals.
 //
 
+#include <optional>
+
 #include "ir/equivalent_sets.h"
 #include <ir/branch-utils.h>
+#include <ir/effect-cache.h>
 #include <ir/effects.h>
 #include <ir/find_all.h>
 #include <ir/linear-execution.h>
@@ -69,6 +72,9 @@ template<bool allowTee = true,
 struct SimplifyLocals
   : public WalkerPass<LinearExecutionWalker<
       SimplifyLocals<allowTee, allowStructure, allowNesting>>> {
+  using Super = WalkerPass<LinearExecutionWalker<
+    SimplifyLocals<allowTee, allowStructure, allowNesting>>>;
+
   bool isFunctionParallel() override { return true; }
 
   std::unique_ptr<Pass> create() override {
@@ -81,8 +87,8 @@ struct SimplifyLocals
     Expression** item;
     EffectAnalyzer effects;
 
-    SinkableInfo(Expression** item, PassOptions& passOptions, Module& module)
-      : item(item), effects(passOptions, module, *item) {}
+    SinkableInfo(Expression** item, EffectAnalyzer&& effects)
+      : item(item), effects(std::move(effects)) {}
   };
 
   // a list of sinkables in a linear execution trace
@@ -125,6 +131,16 @@ struct SimplifyLocals
   // In rare cases we make a change to a type that requires a refinalize.
   bool refinalize = false;
 
+  // The effects of sinkable sets. A set may contain other sets that were
+  // sinkable before it, whose effects we can reuse this way. This is cleared
+  // after each cycle of the main optimizations.
+  std::optional<EffectCache> effectCache;
+
+  Expression* replaceCurrent(Expression* expression) {
+    effectCache->invalidate(this->getCurrent());
+    return Super::replaceCurrent(expression);
+  }
+
   static void
   doNoteNonLinear(SimplifyLocals<allowTee, allowStructure, allowNesting>* self,
                   Expression** currp) {
@@ -251,11 +267,13 @@ struct SimplifyLocals
         // if we can't nest 's a copy with multiple uses, then we can't create
         // a tee, and we can't nop the origin, but we can at least switch to
         // the copied index, which may make the origin unneeded eventually.
+        effectCache->invalidate(curr);
         curr->index = get->index;
         anotherCycle = true;
         return;
       }
       // sink it, and nop the origin
+      effectCache->invalidate(set);
       if (oneUse) {
         // with just one use, we can sink just the value
         this->replaceCurrent(set->value);
@@ -294,6 +312,7 @@ struct SimplifyLocals
     auto* set = curr->value->dynCast<LocalSet>();
     if (set) {
       assert(set->isTee());
+      effectCache->invalidate(set);
       set->makeSet();
       this->replaceCurrent(set);
     }
@@ -416,6 +435,7 @@ struct SimplifyLocals
         auto* previous = (*found->second.item)->template cast<LocalSet>();
         assert(!previous->isTee());
         auto* previousValue = previous->value;
+        self->effectCache->invalidate(previous);
         Drop* drop = ExpressionManipulator::convert<LocalSet, Drop>(previous);
         drop->value = previousValue;
         drop->finalize();
@@ -432,9 +452,8 @@ struct SimplifyLocals
     if (set && self->canSink(set)) {
       Index index = set->index;
       assert(self->sinkables.count(index) == 0);
-      self->sinkables.emplace(std::pair{
-        index,
-        SinkableInfo(currp, self->getPassOptions(), *self->getModule())});
+      self->sinkables.emplace(
+        std::pair{index, SinkableInfo(currp, self->effectCache->get(set))});
     }
 
     if (!allowNesting) {
@@ -451,8 +470,7 @@ struct SimplifyLocals
     // 'catch', because 'pop' should follow right after 'catch'.
     FeatureSet features = this->getModule()->features;
     if (features.hasExceptionHandling() &&
-        EffectAnalyzer(this->getPassOptions(), *this->getModule(), set->value)
-          .danglingPop) {
+        effectCache->get(set->value).danglingPop) {
       return false;
     }
     // if in the first cycle, or not allowing tees, then we cannot sink if >1
@@ -488,6 +506,7 @@ struct SimplifyLocals
     Builder builder(*this->getModule());
     auto** item = sinkables.at(goodIndex).item;
     auto* set = (*item)->template cast<LocalSet>();
+    effectCache->invalidate(set);
     block->list[block->list.size() - 1] = set->value;
     *item = builder.makeNop();
     block->finalize();
@@ -595,6 +614,7 @@ struct SimplifyLocals
     // set
     auto* blockLocalSetPointer = sinkables.at(sharedIndex).item;
     auto* value = (*blockLocalSetPointer)->template cast<LocalSet>()->value;
+    effectCache->invalidate(*blockLocalSetPointer);
     block->list[block->list.size() - 1] = value;
     ExpressionManipulator::nop(*blockLocalSetPointer);
     for (size_t j = 0; j < breaks.size(); j++) {
@@ -606,6 +626,8 @@ struct SimplifyLocals
       // if the break is conditional, then we must set the value here - if the
       // break is not reached, we must still have the new value in the local
       auto* set = (*breakLocalSetPointer)->template cast<LocalSet>();
+      effectCache->invalidate(set);
+      effectCache->invalidate(br);
       if (br->condition) {
         br->value = set;
         set->makeTee(this->getFunction()->getLocalType(set->index));
@@ -707,6 +729,7 @@ struct SimplifyLocals
     // all set, go
     if (iff->ifTrue->type != Type::unreachable) {
       auto* ifTrueItem = ifTrue.at(goodIndex).item;
+      effectCache->invalidate(*ifTrueItem);
       ifTrueBlock->list[ifTrueBlock->list.size() - 1] =
         (*ifTrueItem)->template cast<LocalSet>()->value;
       ExpressionManipulator::nop(*ifTrueItem);
@@ -715,6 +738,7 @@ struct SimplifyLocals
     }
     if (iff->ifFalse->type != Type::unreachable) {
       auto* ifFalseItem = ifFalse.at(goodIndex).item;
+      effectCache->invalidate(*ifFalseItem);
       ifFalseBlock->list[ifFalseBlock->list.size() - 1] =
         (*ifFalseItem)->template cast<LocalSet>()->value;
       ExpressionManipulator::nop(*ifFalseItem);
@@ -723,6 +747,7 @@ struct SimplifyLocals
     }
     iff->finalize(); // update type
     assert(iff->type != Type::none);
+    effectCache->invalidate(iff);
     // finally, create a local.set on the iff itself
     auto* newLocalSet =
       Builder(*this->getModule()).makeLocalSet(goodIndex, iff);
@@ -818,6 +843,8 @@ struct SimplifyLocals
     Builder builder(*this->getModule());
     auto** item = sinkables.at(goodIndex).item;
     auto* set = (*item)->template cast<LocalSet>();
+    effectCache->invalidate(set);
+    effectCache->invalidate(iff);
     ifTrueBlock->list[ifTrueBlock->list.size() - 1] = set->value;
     *item = builder.makeNop();
     ifTrueBlock->finalize();
@@ -879,6 +906,7 @@ struct SimplifyLocals
     }
     // scan local.gets
     getCounter.analyze(func);
+    effectCache.emplace(this->getPassOptions(), *this->getModule());
     // multiple passes may be required per function, consider this:
     //    x = load
     //    y = store
@@ -974,6 +1002,7 @@ struct SimplifyLocals
     sinkables.clear();
     blockBreaks.clear();
     unoptimizableBlocks.clear();
+    effectCache->clear();
     return anotherCycle;
   }
 
@@ -0,0 +1,344 @@
+/*
+ * Copyright 2023 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include "ir/module-utils.h"
+#include "passes/function-cache.h"
+#include "support/hash.h"
+#include "support/threads.h"
+#include "wasm-binary.h"
+#include "wasm-builder.h"
+
+namespace wasm {
+
+namespace {
+
+// The version of the format of the cache. It is part of the context hash, so
+// changing it invalidates all existing entries. Bump it whenever what we
+// serialize, or the way we store entries, changes.
+const int FormatVersion = 1;
+
+// Finds the functions and globals a function refers to. Other module elements
+// are few, so we simply serialize all of them.
+struct ReferenceFinder : public PostWalker<ReferenceFinder> {
+  // Ordered, so that the serialization is deterministic.
+  std::set<Name> functions;
+  std::set<Name> globals;
+
+  void visitCall(Call* curr) { functions.insert(curr->target); }
+  void visitRefFunc(RefFunc* curr) { functions.insert(curr->func); }
+  void visitGlobalGet(GlobalGet* curr) { globals.insert(curr->name); }
+  void visitGlobalSet(GlobalSet* curr) { globals.insert(curr->name); }
+};
+
+// Serializes a function into a small module that contains it, stubs for the
+// functions it calls, imports for the globals it uses, and the tables,
+// memories, tags and segments of the module. The contents of segments and the
+// values of globals are part of the context hash instead.
+std::string serialize(Module& wasm, Function* func) {
+  Module module;
+  module.features = wasm.features;
+  ModuleUtils::copyFunction(func, module);
+
+  ReferenceFinder finder;
+  finder.walk(func->body);
+  Builder builder(module);
+  for (auto name : finder.functions) {
+    if (name == func->name) {
+      continue;
+    }
+    auto* callee = wasm.getFunction(name);
+    auto stub = Builder::makeFunction(name, callee->type, {});
+    if (callee->imported()) {
+      stub->module = callee->module;
+      stub->base = callee->base;
+    } else {
+      stub->body = builder.makeUnreachable();
+    }
+    module.addFunction(std::move(stub));
+  }
+  for (auto name : finder.globals) {
+    auto* global = wasm.getGlobal(name);
+    auto import = Builder::makeGlobal(
+      name,
+      global->type,
+      nullptr,
+      global->mutable_ ? Builder::Mutable : Builder::Immutable);
+    import->module = "env";
+    import->base = name;
+    module.addGlobal(std::move(import));
+  }
+  for (auto& table : wasm.tables) {
+    ModuleUtils::copyTable(table.get(), module);
+  }
+  for (auto& memory : wasm.memories) {
+    auto* copy = ModuleUtils::copyMemory(memory.get(), module);
+    copy->module = memory->module;
+    copy->base = memory->base;
+  }
+  for (auto& tag : wasm.tags) {
+    auto* copy = ModuleUtils::copyTag(tag.get(), module);
+    copy->module = tag->module;
+    copy->base = tag->base;
+  }
+  for (auto& segment : wasm.elementSegments) {
+    module.addElementSegment(Builder::makeElementSegment(
+      segment->name, Name(), nullptr, segment->type));
+  }
+  for (auto& segment : wasm.dataSegments) {
+    module.addDataSegment(
+      Builder::makeDataSegment(segment->name, Name(), true));
+  }
+
+  BufferWithRandomAccess buffer;
+  WasmBinaryWriter writer(&module, buffer);
+  writer.setNamesSection(true);
+  writer.write();
+  return std::string(buffer.begin(), buffer.end());
+}
+
+// Reads the optimized version of a function from its serialization, and
+// replaces its body. Returns false if we cannot use it.
+bool deserialize(Module& wasm, Function* func, std::string_view data) {
+  Module module;
+  try {
+    WasmBinaryBuilder reader(module, wasm.features, data);
+    reader.read();
+  } catch (ParseException&) {
+    return false;
+  }
+  auto* cached = module.getFunctionOrNull(func->name);
+  if (!cached || cached->imported() || cached->type != func->type) {
+    return false;
+  }
+  // Names must have survived the round trip for the references to be valid.
+  ReferenceFinder finder;
+  finder.walk(cached->body);
+  for (auto name : finder.functions) {
+    if (!wasm.getFunctionOrNull(name)) {
+      return false;
+    }
+  }
+  for (auto name : finder.globals) {
+    if (!wasm.getGlobalOrNull(name)) {
+      return false;
+    }
+  }
+  func->vars = cached->vars;
+  func->localNames = cached->localNames;
+  func->localIndices = cached->localIndices;
+  func->body = ExpressionManipulator::copy(cached->body, wasm);
+  return true;
+}
+
+// Whether a function has information that does not survive serialization.
+bool isCacheable(Function* func) {
+  return func->debugLocations.empty() && func->prologLocation.empty() &&
+         func->epilogLocation.empty() && func->expressionLocations.empty() &&
+         !func->stackIR;
+}
+
+// Calls a function on each index up to |size|, in parallel.
+template<typename T> void doInParallel(size_t size, T work) {
+  std::atomic<size_t> next(0);
+  size_t num = ThreadPool::get()->size();
+  std::vector<std::function<ThreadWorkState()>> doWorkers;
+  for (size_t i = 0; i < num; i++) {
+    doWorkers.push_back([&]() {
+      auto index = next.fetch_add(1);
+      if (index >= size) {
+        return ThreadWorkState::Finished;
+      }
+      work(index);
+      return ThreadWorkState::More;
+    });
+  }
+  ThreadPool::get()->work(doWorkers);
+}
+
+size_t hashContext(Module& wasm,
+                   const PassOptions& options,
+                   const std::vector<Pass*>& passes) {
+  std::stringstream ss;
+  ss << FormatVersion << '\n' << wasm.features.toString() << '\n';
+  ss << options.optimizeLevel << ' ' << options.shrinkLevel << ' '
+     << options.inlining.alwaysInlineMaxSize << ' '
+     << options.inlining.oneCallerInlineMaxSize << ' '
+     << options.inlining.flexibleInlineMaxSize << ' '
+     << options.inlining.allowFunctionsWithLoops << ' '
+     << options.inlining.partialInliningIfs << ' '
+     << options.inlining.bottomUp << ' '
+     << options.inlining.maxCodeGrowth << ' '
+     << options.ignoreImplicitTraps << ' ' << options.trapsNeverHappen << ' '
+     << options.lowMemoryUnused << ' ' << options.fastMath << ' '
+     << options.zeroFilledMemory << ' ' << options.closedWorld << ' '
+     << options.debugInfo << ' ' << options.targetJS << '\n';
+  std::map<std::string, std::string> arguments(options.arguments.begin(),
+                                               options.arguments.end());
+  for (auto& [key, value] : arguments) {
+    ss << key << '=' << value << '\n';
+  }
+  for (auto* pass : passes) {
+    ss << pass->name << '\n';
+  }
+  for (auto& global : wasm.globals) {
+    ss << global->name << ' ' << global->type << ' ' << global->mutable_;
+    if (global->imported()) {
+      ss << ' ' << global->module << ' ' << global->base << '\n';
+    } else {
+      ss << ' ' << *global->init << '\n';
+    }
+  }
+  for (auto& exp : wasm.exports) {
+    ss << exp->name << ' ' << int(exp->kind) << ' ' << exp->value << '\n';
+  }
+  for (auto& segment : wasm.elementSegments) {
+    ss << segment->name << ' ' << segment->table;
+    if (segment->offset) {
+      ss << ' ' << *segment->offset;
+    }
+    for (auto* item : segment->data) {
+      ss << ' ' << *item;
+    }
+    ss << '\n';
+  }
+  for (auto& segment : wasm.dataSegments) {
+    ss << segment->name << ' ' << segment->memory << ' '
+       << segment->isPassive;
+    if (segment->offset) {
+      ss << ' ' << *segment->offset;
+    }
+    ss << ' '
+       << std::hash<std::string_view>{}(
+            {segment->data.data(), segment->data.size()})
+       << '\n';
+  }
+  return std::hash<std::string>{}(ss.str());
+}
+
+} // anonymous namespace
+
+FunctionCache::FunctionCache(Module& wasm,
+                             const PassOptions& options,
+                             const std::vector<Pass*>& passes)
+  : wasm(wasm), directory(options.functionCache) {
+  // Function effects are computed for the entire module, and nominal types
+  // are not preserved when reading a serialized function back.
+  if (options.funcEffectsMap || getTypeSystem() != TypeSystem::Isorecursive) {
+    enabled = false;
+    return;
+  }
+  context = hashContext(wasm, options, passes);
+}
+
+std::string FunctionCache::getPath(const std::string& input) {
+  auto key = std::hash<std::string>{}(input);
+  hash_combine(key, context);
+  std::stringstream ss;
+  ss << directory << '/' << std::hex << key << ".wasm";
+  return ss.str();
+}
+
+// An entry in the cache is the context hash and the size of the input,
+// followed by the input and the output.
+void FunctionCache::restore() {
+  if (!enabled) {
+    return;
+  }
+  std::vector<Function*> funcs;
+  ModuleUtils::iterDefinedFunctions(wasm, [&](Function* func) {
+    if (isCacheable(func)) {
+      funcs.push_back(func);
+    }
+  });
+  // Serializing is the bulk of the work, so do it in parallel, noting the
+  // results in order so that what we do with them is deterministic.
+  std::vector<std::string> inputs(funcs.size());
+  std::vector<char> hits(funcs.size());
+  doInParallel(funcs.size(), [&](size_t i) {
+    auto* func = funcs[i];
+    auto& input = inputs[i];
+    input = serialize(wasm, func);
+    std::ifstream file(getPath(input), std::ios::binary);
+    if (!file) {
+      return;
+    }
+    std::string entry((std::istreambuf_iterator<char>(file)),
+                      std::istreambuf_iterator<char>());
+    size_t header[2];
+    if (entry.size() >= sizeof(header)) {
+      std::memcpy(header, entry.data(), sizeof(header));
+      std::string_view rest(entry);
+      rest.remove_prefix(sizeof(header));
+      if (header[0] == context && header[1] <= rest.size() &&
+          rest.substr(0, header[1]) == input &&
+          deserialize(wasm, func, rest.substr(header[1]))) {
+        hits[i] = true;
+      }
+    }
+  });
+  for (size_t i = 0; i < funcs.size(); i++) {
+    if (hits[i]) {
+      restored.insert(funcs[i]);
+    } else {
+      misses.emplace_back(funcs[i], std::move(inputs[i]));
+    }
+  }
+}
+
+void FunctionCache::store() {
+  if (!enabled) {
+    return;
+  }
+  doInParallel(misses.size(), [&](size_t i) {
+    auto& [func, input] = misses[i];
+    if (!isCacheable(func)) {
+      return;
+    }
+    auto output = serialize(wasm, func);
+    auto path = getPath(input);
+    // Write to a temporary file and then move it into place, so that other
+    // processes sharing the cache never see a partial entry. Identical
+    // functions have the same entry, so the temporary file also notes which
+    // one we are writing.
+    std::stringstream temp;
+    temp << path << '.'
+         << std::chrono::steady_clock::now().time_since_epoch().count() << '.'
+         << i;
+    {
+      std::ofstream file(temp.str(), std::ios::binary);
+      if (!file) {
+        return;
+      }
+      size_t header[2] = {context, input.size()};
+      file.write((const char*)header, sizeof(header));
+      file << input << output;
+    }
+    if (std::rename(temp.str().c_str(), path.c_str())) {
+      std::remove(temp.str().c_str());
+    }
+  });
+}
+
+} // namespace wasm
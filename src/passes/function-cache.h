@@ -0,0 +1,76 @@
+/*
+ * Copyright 2023 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef wasm_passes_function_cache_h
+#define wasm_passes_function_cache_h
+
+#include "pass.h"
+#include "wasm.h"
+
+//
+// An on-disk cache of the results of running a sequence of function-parallel
+// passes on functions, so that when a module is optimized again after only a
+// few of its functions changed, we can reuse the optimized bodies of the rest.
+//
+// Each function is serialized as a small wasm module that contains it along
+// with the module elements it refers to, and the key is that serialization
+// plus a hash of everything else that may affect the result: the passes and
+// their options, and module-level context like globals, exports and element
+// segments. Function-parallel passes only modify the function they run on, but
+// they could in principle read the bodies of other functions, which we do not
+// take into account, so this is opt-in. Nor do we take into account the
+// version of the optimizer, so a cache should not be shared between different
+// builds of it.
+//
+
+namespace wasm {
+
+class FunctionCache {
+public:
+  FunctionCache(Module& wasm,
+                const PassOptions& options,
+                const std::vector<Pass*>& passes);
+
+  // Replaces the bodies of functions for which we have results in the cache.
+  void restore();
+
+  // Whether the function's body was restored, so that the passes need not run
+  // on it.
+  bool isRestored(Function* func) { return restored.count(func); }
+
+  // Saves the results for the functions that were not restored, after the
+  // passes ran on them.
+  void store();
+
+private:
+  Module& wasm;
+  std::string directory;
+  // A hash of the passes and module-level context.
+  size_t context;
+  // Whether we can use the cache at all.
+  bool enabled = true;
+
+  std::unordered_set<Function*> restored;
+
+  // The serialized inputs of the functions whose results we will store.
+  std::vector<std::pair<Function*, std::string>> misses;
+
+  std::string getPath(const std::string& input);
+};
+
+} // namespace wasm
+
+#endif // wasm_passes_function_cache_h
@@ -15,6 +15,8 @@
  */
 
 #include <chrono>
+#include <ctime>
+#include <deque>
 #include <sstream>
 
 #ifdef __linux__
@@ -24,7 +26,9 @@
 #include "ir/hashed.h"
 #include "ir/module-utils.h"
 #include "ir/type-updating.h"
+#include "ir/utils.h"
 #include "pass.h"
+#include "passes/function-cache.h"
 #include "passes/passes.h"
 #include "support/colors.h"
 #include "wasm-debug.h"
@@ -692,10 +696,207 @@ static void dumpWasm(Name name, Module* wasm) {
   writer.writeBinary(*wasm, fullName + ".wasm");
 }
 
+namespace {
+
+// Hands out the defined functions of a module to the threads of the pool.
+// Functions can differ enormously in size, and if a few huge ones are left for
+// last then a single thread ends up working on them while the others sit idle.
+// To avoid that we estimate the cost of each function up front, deal them out
+// to per-thread queues with the largest first, and let threads that run out of
+// work steal from the others.
+struct FunctionScheduler {
+  using Clock = std::chrono::steady_clock;
+
+  struct Worker {
+    std::mutex mutex;
+    // Sorted from most to least expensive. The owner pops from the front and
+    // thieves steal from the back.
+    std::deque<Function*> queue;
+    // When this worker found no more work anywhere.
+    Clock::time_point finished;
+  };
+
+  std::vector<Worker> workers;
+  size_t numFunctions = 0;
+
+  FunctionScheduler(Module& wasm, size_t num) : workers(num) {
+    std::vector<std::pair<Index, Function*>> costs;
+    ModuleUtils::iterDefinedFunctions(wasm, [&](Function* func) {
+      costs.emplace_back(Measurer::measure(func->body), func);
+    });
+    numFunctions = costs.size();
+    // Sort by decreasing cost, keeping module order among equals so that the
+    // schedule is deterministic.
+    std::stable_sort(costs.begin(), costs.end(), [](auto& a, auto& b) {
+      return a.first > b.first;
+    });
+    // Greedily give each function to the worker with the least work so far.
+    std::vector<size_t> loads(num);
+    for (auto& [cost, func] : costs) {
+      auto least = std::min_element(loads.begin(), loads.end());
+      workers[least - loads.begin()].queue.push_back(func);
+      // Count a little overhead per function so empty ones spread out too.
+      *least += size_t(cost) + 1;
+    }
+  }
+
+  // Returns the next function for a worker to process, or nullptr if there is
+  // no work left anywhere.
+  Function* next(size_t index) {
+    auto& self = workers[index];
+    {
+      std::lock_guard<std::mutex> lock(self.mutex);
+      if (!self.queue.empty()) {
+        auto* func = self.queue.front();
+        self.queue.pop_front();
+        return func;
+      }
+    }
+    for (size_t i = 1; i < workers.size(); i++) {
+      auto& victim = workers[(index + i) % workers.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.queue.empty()) {
+        auto* func = victim.queue.back();
+        victim.queue.pop_back();
+        return func;
+      }
+    }
+    self.finished = Clock::now();
+    return nullptr;
+  }
+
+  // The time between the first worker running out of work and the last one
+  // finishing, during which some threads were idle.
+  double getIdleTail() {
+    auto first = workers[0].finished, last = workers[0].finished;
+    for (auto& worker : workers) {
+      first = std::min(first, worker.finished);
+      last = std::max(last, worker.finished);
+    }
+    return std::chrono::duration<double>(last - first).count();
+  }
+};
+
+} // anonymous namespace
+
+// Collects a profile of the passes we run when BINARYEN_PASS_PROFILE is set to
+// a filename. Unlike BINARYEN_PASS_DEBUG this does not validate or otherwise
+// change what we do, except that each function-parallel pass is run on all the
+// functions by itself so that it can be measured separately. For each pass,
+// including passes in nested runners, we record the wall time, the CPU time
+// summed over all threads, the bytes allocated in arenas, and for passes in the
+// main runner, the number of expressions in function bodies before and after
+// the pass. (Counting takes time linear in the module, and nested runners are
+// often run many times, for example once per inlined-into function, so we do
+// not count for them, which would distort their times.) The profile is
+// written in the Chrome trace event format, which is JSON, so it can be viewed
+// in chrome://tracing or Perfetto as well as processed by other tools.
+struct PassProfiler {
+  using Clock = std::chrono::steady_clock;
+
+  struct Event {
+    std::string name;
+    bool nested;
+    bool functionParallel;
+    Clock::time_point start;
+    std::chrono::duration<double> wall;
+    std::clock_t cpu;
+    size_t bytes;
+    // Only counted for passes that are not nested.
+    size_t exprsBefore = 0;
+    size_t exprsAfter = 0;
+  };
+
+  std::string filename;
+  Clock::time_point origin = Clock::now();
+
+  std::mutex mutex;
+  std::vector<Event> events;
+
+  PassProfiler(std::string filename) : filename(filename) {}
+
+  // Returns the profiler, or nullptr if we are not profiling.
+  static PassProfiler* get() {
+    static const char* filename = getenv("BINARYEN_PASS_PROFILE");
+    if (!filename || !*filename) {
+      return nullptr;
+    }
+    static PassProfiler profiler(filename);
+    return &profiler;
+  }
+
+  static size_t countExpressions(Module* wasm) {
+    size_t count = 0;
+    ModuleUtils::iterDefinedFunctions(
+      *wasm, [&](Function* func) { count += Measurer::measure(func->body); });
+    return count;
+  }
+
+  template<typename T>
+  void profile(Pass* pass, Module* wasm, bool nested, T doRun) {
+    Event event;
+    event.name = pass->name;
+    event.nested = nested;
+    event.functionParallel = pass->isFunctionParallel();
+    if (!nested) {
+      event.exprsBefore = countExpressions(wasm);
+    }
+    auto bytes = MixedArena::totalChunkBytes.load();
+    auto cpu = std::clock();
+    event.start = Clock::now();
+    doRun();
+    event.wall = Clock::now() - event.start;
+    event.cpu = std::clock() - cpu;
+    event.bytes = MixedArena::totalChunkBytes.load() - bytes;
+    if (!nested) {
+      event.exprsAfter = countExpressions(wasm);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back(std::move(event));
+  }
+
+  // Write out everything we have seen so far.
+  void write() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Output output(filename, Flags::Text);
+    auto& o = output.getStream();
+    auto micros = [](auto duration) {
+      return std::chrono::duration<double, std::micro>(duration).count();
+    };
+    o << "{\"traceEvents\": [";
+    bool first = true;
+    for (auto& event : events) {
+      if (!first) {
+        o << ',';
+      }
+      first = false;
+      // Pass names are plain identifiers that need no escaping.
+      o << "\n  {\"name\": \"" << event.name << "\", \"cat\": \""
+        << (event.nested ? "nested" : "pass")
+        << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": 0"
+        << ", \"ts\": " << micros(event.start - origin)
+        << ", \"dur\": " << micros(event.wall) << ", \"args\": {"
+        << "\"functionParallel\": "
+        << (event.functionParallel ? "true" : "false")
+        << ", \"cpuSeconds\": " << double(event.cpu) / CLOCKS_PER_SEC
+        << ", \"arenaBytes\": " << event.bytes;
+      if (!event.nested) {
+        o << ", \"exprsBefore\": " << event.exprsBefore
+          << ", \"exprsAfter\": " << event.exprsAfter;
+      }
+      o << "}}";
+    }
+    o << "\n]}\n";
+  }
+};
+
 void PassRunner::run() {
   assert(!ran);
   ran = true;
 
+  // Passes may look at any function, so decode any that were read lazily.
+  ModuleUtils::materializeFunctions(*wasm);
+
   // As we run passes, we'll notice which we skip.
   skippedPasses.clear();
 
@@ -779,45 +980,68 @@ void PassRunner::run() {
     std::vector<Pass*> stack;
     auto flush = [&]() {
       if (stack.size() > 0) {
+        std::unique_ptr<FunctionCache> cache;
+        if (!options.functionCache.empty() && !isNested) {
+          cache = std::make_unique<FunctionCache>(*wasm, options, stack);
+          cache->restore();
+        }
         // run the stack of passes on all the functions, in parallel
         size_t num = ThreadPool::get()->size();
+        FunctionScheduler scheduler(*wasm, num);
         std::vector<std::function<ThreadWorkState()>> doWorkers;
-        std::atomic<size_t> nextFunction;
-        nextFunction.store(0);
-        size_t numFunctions = wasm->functions.size();
         for (size_t i = 0; i < num; i++) {
-          doWorkers.push_back([&]() {
-            auto index = nextFunction.fetch_add(1);
+          doWorkers.push_back([&, i]() {
             // get the next task, if there is one
-            if (index >= numFunctions) {
+            auto* func = scheduler.next(i);
+            if (!func) {
               return ThreadWorkState::Finished; // nothing left
             }
-            Function* func = this->wasm->functions[index].get();
-            if (!func->imported()) {
-              // do the current task: run all passes on this function
-              for (auto* pass : stack) {
-                runPassOnFunction(pass, func);
-              }
+            if (cache && cache->isRestored(func)) {
+              return ThreadWorkState::More;
             }
-            if (index + 1 == numFunctions) {
-              return ThreadWorkState::Finished; // we did the last one
+            // do the current task: run all passes on this function
+            for (auto* pass : stack) {
+              runPassOnFunction(pass, func);
             }
             return ThreadWorkState::More;
           });
         }
         ThreadPool::get()->work(doWorkers);
+        if (cache) {
+          cache->store();
+        }
+        static const bool scheduleStats =
+          getenv("BINARYEN_PASS_SCHEDULE_STATS") != nullptr;
+        if (scheduleStats) {
+          std::cerr << "[PassRunner] ran " << stack.size() << " passes on "
+                    << scheduler.numFunctions << " functions with " << num
+                    << " threads, idle tail: " << scheduler.getIdleTail()
+                    << " seconds." << std::endl;
+        }
       }
       stack.clear();
     };
+    auto* profiler = PassProfiler::get();
     for (auto& pass : passes) {
       if (pass->isFunctionParallel()) {
         stack.push_back(pass.get());
+        if (profiler) {
+          profiler->profile(pass.get(), wasm, isNested, flush);
+        }
       } else {
         flush();
-        runPass(pass.get());
+        if (profiler) {
+          profiler->profile(
+            pass.get(), wasm, isNested, [&]() { runPass(pass.get()); });
+        } else {
+          runPass(pass.get());
+        }
       }
     }
     flush();
+    if (profiler && !isNested) {
+      profiler->write();
+    }
   }
 
   if (!isNested) {
@@ -836,6 +1060,7 @@ void PassRunner::run() {
 }
 
 void PassRunner::runOnFunction(Function* func) {
+  func->materialize();
   if (options.debug) {
     std::cerr << "[PassRunner] running passes on function " << func->name
               << std::endl;
@@ -23,6 +23,14 @@
 #include <iostream>
 #include <limits>
 
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#define HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #define DEBUG_TYPE "file"
 
 std::vector<char> wasm::read_stdin() {
@@ -99,6 +107,43 @@ template std::string wasm::read_file<>(const std::string&, Flags::BinaryOption);
 template std::vector<char> wasm::read_file<>(const std::string&,
                                              Flags::BinaryOption);
 
+wasm::MappedFile::MappedFile(const std::string& filename) {
+#ifdef HAVE_MMAP
+  if (filename != "-") {
+    BYN_TRACE("Mapping '" << filename << "'...\n");
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      Fatal() << "Failed opening '" << filename << "'";
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+      auto size = size_t(info.st_size);
+      auto* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED) {
+        mapping = addr;
+        mappingSize = size;
+        contents = std::string_view(static_cast<const char*>(addr), size);
+      }
+    }
+    close(fd);
+    if (mapping) {
+      return;
+    }
+    // Fall back to reading the file normally.
+  }
+#endif
+  buffer = read_file<std::vector<char>>(filename, Flags::Binary);
+  contents = std::string_view(buffer.data(), buffer.size());
+}
+
+wasm::MappedFile::~MappedFile() {
+#ifdef HAVE_MMAP
+  if (mapping) {
+    munmap(mapping, mappingSize);
+  }
+#endif
+}
+
 wasm::Output::Output(const std::string& filename, Flags::BinaryOption binary)
   : outfile(), out([this, filename, binary]() {
       // Ensure a single return at the very end, to avoid clang-tidy warnings
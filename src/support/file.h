@@ -23,6 +23,7 @@
 
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -48,6 +49,27 @@ extern template std::vector<char> read_file<>(const std::string&,
 // is not a response file, return it as is.
 std::string read_possible_response_file(const std::string&);
 
+// The contents of a binary file, memory-mapped when the platform supports it
+// rather than copied into a buffer. Mapping the file avoids holding a second
+// copy of a large input in memory while it is parsed, and lets the OS page it
+// in as it is read. "-" reads stdin into a buffer instead.
+class MappedFile {
+public:
+  MappedFile(const std::string& filename);
+  ~MappedFile();
+
+  std::string_view data() const { return contents; }
+
+private:
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  void* mapping = nullptr;
+  size_t mappingSize = 0;
+  // Used when we cannot map the file.
+  std::vector<char> buffer;
+  std::string_view contents;
+};
+
 class Output {
 public:
   // An empty filename or "-" will open stdout instead.
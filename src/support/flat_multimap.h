@@ -0,0 +1,131 @@
+/*
+ * Copyright 2023 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// A read-only map from keys to lists of values, built once from a list of
+// (key, value) pairs. All the values are stored in one flat array, and each key
+// refers to its range in it, which avoids allocating per key and keeps things
+// compact in memory, in return for not being modifiable.
+//
+// Looking up a key that is not present gives an empty list, like reading an
+// unordered_map<K, set<V>> with operator[] would, but without inserting it.
+//
+
+#ifndef wasm_support_flat_multimap_h
+#define wasm_support_flat_multimap_h
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace wasm {
+
+template<typename K, typename V> class FlatMultimap {
+public:
+  // The values for a key.
+  class Values {
+  public:
+    Values() = default;
+    Values(const V* first, size_t count) : first(first), count_(count) {}
+
+    const V* begin() const { return first; }
+    const V* end() const { return first + count_; }
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    size_t count(const V& x) const {
+      return std::find(begin(), end(), x) != end();
+    }
+
+  private:
+    const V* first = nullptr;
+    size_t count_ = 0;
+  };
+
+  using Entry = std::pair<K, Values>;
+  using const_iterator = typename std::vector<Entry>::const_iterator;
+
+  FlatMultimap() = default;
+
+  // Keys are ordered by their first appearance in the pairs, and the values
+  // for each key by their order in the pairs.
+  explicit FlatMultimap(const std::vector<std::pair<K, V>>& pairs) {
+    // Count the values for each key, then place each key's values after those
+    // of the keys before it.
+    std::vector<size_t> counts;
+    for (auto& [key, _] : pairs) {
+      auto [iter, inserted] = indexes.emplace(key, entries.size());
+      if (inserted) {
+        entries.push_back({key, Values()});
+        counts.push_back(0);
+      }
+      counts[iter->second]++;
+    }
+    std::vector<size_t> positions(counts.size());
+    size_t start = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+      positions[i] = start;
+      start += counts[i];
+    }
+    values.resize(pairs.size());
+    for (auto& [key, value] : pairs) {
+      values[positions[indexes[key]]++] = value;
+    }
+    for (size_t i = 0; i < entries.size(); i++) {
+      entries[i].second =
+        Values(values.data() + positions[i] - counts[i], counts[i]);
+    }
+  }
+
+  // The values point into our storage, so we must not be copied.
+  FlatMultimap(const FlatMultimap&) = delete;
+  FlatMultimap& operator=(const FlatMultimap&) = delete;
+  FlatMultimap(FlatMultimap&&) = default;
+  FlatMultimap& operator=(FlatMultimap&&) = default;
+
+  const Values& operator[](const K& key) const {
+    auto iter = find(key);
+    if (iter == end()) {
+      static const Values empty;
+      return empty;
+    }
+    return iter->second;
+  }
+
+  const_iterator find(const K& key) const {
+    auto iter = indexes.find(key);
+    if (iter == indexes.end()) {
+      return end();
+    }
+    return entries.begin() + iter->second;
+  }
+
+  size_t count(const K& key) const { return indexes.count(key); }
+
+  const_iterator begin() const { return entries.begin(); }
+  const_iterator end() const { return entries.end(); }
+  size_t size() const { return entries.size(); }
+  bool empty() const { return entries.empty(); }
+
+private:
+  std::unordered_map<K, size_t> indexes;
+  std::vector<Entry> entries;
+  std::vector<V> values;
+};
+
+} // namespace wasm
+
+#endif // wasm_support_flat_multimap_h
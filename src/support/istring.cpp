@@ -40,15 +40,24 @@ std::string_view IString::interned(std::string_view s, bool reuse) {
   using StringSet =
     std::unordered_set<MutStringView, MutStringViewHash, MutStringViewEqual>;
 
-  // The authoritative global set of interned string views.
-  static StringSet globalStrings;
+  // The authoritative global set of interned string views is split into
+  // shards by hash so that threads interning different strings do not contend
+  // on a single lock. A given string always maps to the same shard, so there is
+  // still exactly one interned copy of it, which is what gives us pointer
+  // identity.
+  struct Shard {
+    StringSet strings;
 
-  // The global backing store for interned strings that do not otherwise have
-  // stable addresses.
-  static std::vector<std::vector<char>> allocated;
+    // The backing store for interned strings that do not otherwise have stable
+    // addresses.
+    std::vector<std::vector<char>> allocated;
 
-  // Guards access to `globalStrings` and `allocated`.
-  static std::mutex mutex;
+    // Guards access to `strings` and `allocated`.
+    std::mutex mutex;
+  };
+  static constexpr size_t ShardBits = 6;
+  static constexpr size_t NumShards = size_t(1) << ShardBits;
+  static Shard shards[NumShards];
 
   // A thread-local cache of strings to reduce contention.
   thread_local static StringSet localStrings;
@@ -59,9 +68,12 @@ std::string_view IString::interned(std::string_view s, bool reuse) {
     return localIt->str;
   }
 
-  // No copy yet in the local cache. Check the global cache.
-  std::unique_lock<std::mutex> lock(mutex);
-  auto [globalIt, globalInserted] = globalStrings.insert(s);
+  // No copy yet in the local cache. Check the global cache. Use the high bits
+  // of the hash to pick the shard, as the low bits pick the bucket inside it.
+  auto hash = std::hash<std::string_view>{}(s);
+  auto& shard = shards[hash >> (sizeof(size_t) * 8 - ShardBits)];
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  auto [globalIt, globalInserted] = shard.strings.insert(s);
   if (!globalInserted) {
     // We already had a global copy of this string. Cache it locally.
     localIt->str = globalIt->str;
@@ -72,12 +84,12 @@ std::string_view IString::interned(std::string_view s, bool reuse) {
     // We have a new string, but it doesn't have a stable address. Create a copy
     // of the data at a stable address we can use. Make sure it is null
     // terminated so legacy uses that get a C string still work.
-    allocated.emplace_back();
-    auto& data = allocated.back();
+    shard.allocated.emplace_back();
+    auto& data = shard.allocated.back();
     data.reserve(s.size() + 1);
     data.insert(data.end(), s.begin(), s.end());
     data.push_back('\0');
-    s = std::string_view(allocated.back().data(), s.size());
+    s = std::string_view(data.data(), s.size());
   }
 
   // Intern our new string.
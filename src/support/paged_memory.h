@@ -0,0 +1,144 @@
+/*
+ * Copyright 2023 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// A sparse byte-addressed memory, for interpreters. Memory is kept in small
+// pages that are allocated the first time they are written to, so untouched
+// memory reads as zero and costs nothing but an entry in the page table.
+//
+// Copying a PagedMemory is cheap, as the copy shares the pages with the
+// original, and a page is copied only when it is written to while it is
+// shared. That makes copies useful as snapshots of the state of execution,
+// which can be restored by assigning them back.
+//
+
+#ifndef wasm_support_paged_memory_h
+#define wasm_support_paged_memory_h
+
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace wasm {
+
+class PagedMemory {
+public:
+  static constexpr size_t PageBits = 12;
+  static constexpr size_t PageSize = size_t(1) << PageBits;
+
+  size_t size() const { return bytes; }
+
+  void resize(size_t newSize) {
+    if (newSize < bytes) {
+      // Clear what is no longer in bounds, in case we grow again.
+      auto end = std::min(bytes, (newSize + PageSize - 1) & ~(PageSize - 1));
+      if (end > newSize) {
+        fill(newSize, 0, end - newSize);
+      }
+    }
+    pages.resize((newSize + PageSize - 1) >> PageBits);
+    bytes = newSize;
+  }
+
+  template<typename T> T get(size_t address) const {
+    T value;
+    read(address, (char*)&value, sizeof(T));
+    return value;
+  }
+
+  template<typename T> void set(size_t address, T value) {
+    write(address, (const char*)&value, sizeof(T));
+  }
+
+  void read(size_t address, char* dest, size_t size) const {
+    assert(address + size <= bytes);
+    while (size) {
+      auto offset = address & (PageSize - 1);
+      auto chunk = std::min(size, PageSize - offset);
+      if (auto& page = pages[address >> PageBits]) {
+        std::memcpy(dest, page->data() + offset, chunk);
+      } else {
+        std::memset(dest, 0, chunk);
+      }
+      address += chunk;
+      dest += chunk;
+      size -= chunk;
+    }
+  }
+
+  void write(size_t address, const char* src, size_t size) {
+    assert(address + size <= bytes);
+    while (size) {
+      auto offset = address & (PageSize - 1);
+      auto chunk = std::min(size, PageSize - offset);
+      std::memcpy(getWritablePage(address) + offset, src, chunk);
+      address += chunk;
+      src += chunk;
+      size -= chunk;
+    }
+  }
+
+  void fill(size_t address, char value, size_t size) {
+    assert(address + size <= bytes);
+    while (size) {
+      auto offset = address & (PageSize - 1);
+      auto chunk = std::min(size, PageSize - offset);
+      // Filling an untouched page with zeros leaves it as it is.
+      if (value || pages[address >> PageBits]) {
+        std::memset(getWritablePage(address) + offset, value, chunk);
+      }
+      address += chunk;
+      size -= chunk;
+    }
+  }
+
+  // Returns the number of bytes in pages that were allocated.
+  size_t getAllocatedBytes() const {
+    size_t ret = 0;
+    for (auto& page : pages) {
+      if (page) {
+        ret += PageSize;
+      }
+    }
+    return ret;
+  }
+
+private:
+  using Page = std::array<char, PageSize>;
+
+  // Pages that were never written to are null. A page may be shared with
+  // copies of this memory, if its use count is more than one.
+  std::vector<std::shared_ptr<Page>> pages;
+
+  size_t bytes = 0;
+
+  char* getWritablePage(size_t address) {
+    auto& page = pages[address >> PageBits];
+    if (!page) {
+      page = std::make_shared<Page>();
+      page->fill(0);
+    } else if (page.use_count() > 1) {
+      page = std::make_shared<Page>(*page);
+    }
+    return page->data();
+  }
+};
+
+} // namespace wasm
+
+#endif // wasm_support_paged_memory_h
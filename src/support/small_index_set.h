@@ -0,0 +1,281 @@
+/*
+ * Copyright 2023 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// A set of indexes, such as local indexes, which is often small. While the
+// number of items is small they are stored in order in an inline array, which
+// does not allocate. Once the size is large enough, we switch to a bitset
+// indexed by the index, which makes merging and intersecting sets word-wise
+// operations.
+//
+// Like std::set, iteration is in increasing order.
+//
+
+#ifndef wasm_support_small_index_set_h
+#define wasm_support_small_index_set_h
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <iterator>
+#include <vector>
+
+#include "support/bits.h"
+#include "support/index.h"
+
+namespace wasm {
+
+template<size_t N> class SmallIndexSet {
+  // fixed-space storage, in increasing order
+  std::array<Index, N> fixed;
+  size_t used = 0;
+
+  // Bits for the indexes, when we are not using fixed storage. We switch back
+  // to fixed storage only when cleared, to avoid going back and forth.
+  bool usingFixed = true;
+  std::vector<uint64_t> bits;
+  size_t bitsCount = 0;
+
+  bool hasBit(Index x) const {
+    return x / 64 < bits.size() && ((bits[x / 64] >> (x % 64)) & 1);
+  }
+
+  // Sets a bit, growing as needed, and returns whether it was clear.
+  bool setBit(Index x) {
+    if (x / 64 >= bits.size()) {
+      bits.resize(x / 64 + 1);
+    }
+    auto& word = bits[x / 64];
+    auto mask = uint64_t(1) << (x % 64);
+    if (word & mask) {
+      return false;
+    }
+    word |= mask;
+    bitsCount++;
+    return true;
+  }
+
+  void switchToBits() {
+    assert(usingFixed);
+    usingFixed = false;
+    bits.clear();
+    bitsCount = 0;
+    for (size_t i = 0; i < used; i++) {
+      setBit(fixed[i]);
+    }
+    used = 0;
+  }
+
+public:
+  using value_type = Index;
+  using key_type = Index;
+  using size_type = size_t;
+
+  SmallIndexSet() = default;
+
+  void insert(Index x) {
+    if (!usingFixed) {
+      setBit(x);
+      return;
+    }
+    // Find the insertion point |i| where x should be placed.
+    size_t i = 0;
+    while (i < used && fixed[i] < x) {
+      i++;
+    }
+    if (i < used && fixed[i] == x) {
+      return;
+    }
+    if (used == N) {
+      switchToBits();
+      setBit(x);
+      return;
+    }
+    for (size_t j = used; j > i; j--) {
+      fixed[j] = fixed[j - 1];
+    }
+    fixed[i] = x;
+    used++;
+  }
+
+  // Inserts all the items of another set.
+  void insert(const SmallIndexSet& other) {
+    if (other.usingFixed) {
+      for (size_t i = 0; i < other.used; i++) {
+        insert(other.fixed[i]);
+      }
+      return;
+    }
+    if (usingFixed) {
+      switchToBits();
+    }
+    if (bits.size() < other.bits.size()) {
+      bits.resize(other.bits.size());
+    }
+    bitsCount = 0;
+    for (size_t i = 0; i < bits.size(); i++) {
+      if (i < other.bits.size()) {
+        bits[i] |= other.bits[i];
+      }
+      bitsCount += Bits::popCount(bits[i]);
+    }
+  }
+
+  size_t erase(Index x) {
+    if (!usingFixed) {
+      if (!hasBit(x)) {
+        return 0;
+      }
+      bits[x / 64] &= ~(uint64_t(1) << (x % 64));
+      bitsCount--;
+      return 1;
+    }
+    for (size_t i = 0; i < used; i++) {
+      if (fixed[i] == x) {
+        // We found the item; move things backwards and shrink.
+        for (size_t j = i + 1; j < used; j++) {
+          fixed[j - 1] = fixed[j];
+        }
+        used--;
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+  size_t count(Index x) const {
+    if (!usingFixed) {
+      return hasBit(x);
+    }
+    for (size_t i = 0; i < used; i++) {
+      if (fixed[i] == x) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+  size_t size() const { return usingFixed ? used : bitsCount; }
+
+  bool empty() const { return size() == 0; }
+
+  void clear() {
+    used = 0;
+    usingFixed = true;
+    bits.clear();
+    bitsCount = 0;
+  }
+
+  // Whether we have any item in common with another set.
+  bool intersects(const SmallIndexSet& other) const {
+    if (usingFixed || other.usingFixed) {
+      auto& small = usingFixed ? *this : other;
+      auto& large = usingFixed ? other : *this;
+      for (size_t i = 0; i < small.used; i++) {
+        if (large.count(small.fixed[i])) {
+          return true;
+        }
+      }
+      return false;
+    }
+    auto size = std::min(bits.size(), other.bits.size());
+    for (size_t i = 0; i < size; i++) {
+      if (bits[i] & other.bits[i]) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool operator==(const SmallIndexSet& other) const {
+    if (size() != other.size()) {
+      return false;
+    }
+    return std::all_of(
+      begin(), end(), [&other](Index x) { return other.count(x); });
+  }
+
+  bool operator!=(const SmallIndexSet& other) const {
+    return !(*this == other);
+  }
+
+  // iteration
+
+  struct Iterator {
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = long;
+    using value_type = Index;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    const SmallIndexSet* parent;
+    // The index in fixed storage, or the current bit.
+    size_t pos;
+
+    Iterator(const SmallIndexSet* parent, size_t pos)
+      : parent(parent), pos(pos) {}
+
+    // Moves forward to a set bit, if we are not on one.
+    void skipClearBits() {
+      auto& bits = parent->bits;
+      while (pos / 64 < bits.size()) {
+        auto word = bits[pos / 64] >> (pos % 64);
+        if (word) {
+          pos += Bits::countTrailingZeroes(word);
+          return;
+        }
+        pos = (pos / 64 + 1) * 64;
+      }
+      pos = bits.size() * 64;
+    }
+
+    bool operator==(const Iterator& other) const {
+      return parent == other.parent && pos == other.pos;
+    }
+
+    bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+    Iterator& operator++() {
+      pos++;
+      if (!parent->usingFixed) {
+        skipClearBits();
+      }
+      return *this;
+    }
+
+    value_type operator*() const {
+      return parent->usingFixed ? parent->fixed[pos] : Index(pos);
+    }
+  };
+
+  using iterator = Iterator;
+  using const_iterator = Iterator;
+
+  Iterator begin() const {
+    Iterator ret(this, 0);
+    if (!usingFixed) {
+      ret.skipClearBits();
+    }
+    return ret;
+  }
+  Iterator end() const {
+    return Iterator(this, usingFixed ? used : bits.size() * 64);
+  }
+};
+
+} // namespace wasm
+
+#endif // wasm_support_small_index_set_h
@@ -45,6 +45,9 @@ static std::mutex debug;
 
 namespace wasm {
 
+// Whether the current thread is one of the pool's threads.
+static thread_local bool onPoolThread = false;
+
 // Thread
 
 Thread::Thread(ThreadPool* parent) : parent(parent) {
@@ -76,6 +79,7 @@ void Thread::work(std::function<ThreadWorkState()> doWork_) {
 
 void Thread::mainLoop(void* self_) {
   auto* self = static_cast<Thread*>(self_);
+  onPoolThread = true;
   while (1) {
     DEBUG_THREAD("checking for work\n");
     {
@@ -138,10 +142,16 @@ void ThreadPool::initialize(size_t num) {
   DEBUG_POOL("initialize() is done\n");
 }
 
+// The number of cores set by setNumCores(), if it was called.
+static size_t numCoresOverride = 0;
+
 size_t ThreadPool::getNumCores() {
 #ifdef __EMSCRIPTEN__
   return 1;
 #else
+  if (numCoresOverride) {
+    return numCoresOverride;
+  }
   size_t num = std::max(1U, std::thread::hardware_concurrency());
   if (getenv("BINARYEN_CORES")) {
     num = std::stoi(getenv("BINARYEN_CORES"));
@@ -150,6 +160,11 @@ size_t ThreadPool::getNumCores() {
 #endif
 }
 
+void ThreadPool::setNumCores(size_t num) {
+  assert(!pool);
+  numCoresOverride = num;
+}
+
 ThreadPool* ThreadPool::get() {
   DEBUG_POOL("::get()\n");
   // lock on the creation
@@ -177,6 +192,16 @@ void ThreadPool::work(
     }
     return;
   }
+  if (onPoolThread) {
+    // The pool is busy with the work we are part of, and waiting for it here
+    // would never end, so do all the workers' tasks on this thread.
+    DEBUG_POOL("work() sequentially on a pool thread\n");
+    for (auto& doWorker : doWorkers) {
+      while (doWorker() == ThreadWorkState::More) {
+      }
+    }
+    return;
+  }
   // run in parallel on threads
   // TODO: fancy work stealing
   DEBUG_POOL("work() on threads\n");
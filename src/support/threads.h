@@ -93,6 +93,10 @@ public:
   // Get the number of cores we can use.
   static size_t getNumCores();
 
+  // Set the number of cores we can use, overriding the default. This must be
+  // called before the pool is created.
+  static void setNumCores(size_t num);
+
   // Get the singleton threadpool.
   static ThreadPool* get();
 
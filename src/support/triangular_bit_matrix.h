@@ -0,0 +1,159 @@
+/*
+ * Copyright 2023 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// A symmetric N*N matrix of bits with an empty diagonal, such as an
+// interference graph. Only the cells (low, high) with low < high are stored, at
+// one bit each, which takes a sixteenth of the memory of an N*N matrix of
+// bools. Above a size limit the set cells are kept in a hash set instead, as
+// large matrices tend to be sparse.
+//
+
+#ifndef wasm_support_triangular_bit_matrix_h
+#define wasm_support_triangular_bit_matrix_h
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "support/bits.h"
+
+namespace wasm {
+
+class TriangularBitMatrix {
+public:
+  // The largest size using dense storage, which is 4MB at most.
+  static const uint32_t DenseLimit = 8192;
+
+  TriangularBitMatrix() = default;
+  explicit TriangularBitMatrix(uint32_t n) { recreate(n); }
+
+  uint32_t width() const { return N; }
+
+  bool usingDenseStorage() const { return N <= DenseLimit; }
+
+  // Sets a cell, returning whether it was previously clear.
+  bool set(uint32_t low, uint32_t high) {
+    if (usingDenseStorage()) {
+      auto cell = getCell(low, high);
+      auto& word = dense[cell / 64];
+      auto mask = uint64_t(1) << (cell % 64);
+      if (word & mask) {
+        return false;
+      }
+      word |= mask;
+      return true;
+    }
+    return sparse.insert(getKey(low, high)).second;
+  }
+
+  bool get(uint32_t low, uint32_t high) const {
+    if (usingDenseStorage()) {
+      auto cell = getCell(low, high);
+      return (dense[cell / 64] >> (cell % 64)) & 1;
+    }
+    return sparse.count(getKey(low, high));
+  }
+
+  // Calls a function on the (low, high) coordinates of each set cell. The
+  // order is only deterministic when using dense storage.
+  template<typename F> void forEach(F f) const {
+    if (!usingDenseStorage()) {
+      for (auto key : sparse) {
+        f(uint32_t(key), uint32_t(key >> 32));
+      }
+      return;
+    }
+    for (uint32_t high = 1; high < N; high++) {
+      forEachBit(getCell(0, high), high, [&](uint32_t low) { f(low, high); });
+    }
+  }
+
+  // Calls a function on each j such that the cell for i and j is set, in
+  // increasing order. This takes linear time in the width.
+  template<typename F> void forEachInRow(uint32_t i, F f) const {
+    if (!usingDenseStorage()) {
+      for (uint32_t j = 0; j < N; j++) {
+        if (j != i && get(std::min(i, j), std::max(i, j))) {
+          f(j);
+        }
+      }
+      return;
+    }
+    if (i > 0) {
+      forEachBit(getCell(0, i), i, f);
+    }
+    for (uint32_t high = i + 1; high < N; high++) {
+      auto cell = getCell(i, high);
+      if ((dense[cell / 64] >> (cell % 64)) & 1) {
+        f(high);
+      }
+    }
+  }
+
+  // Resizes the matrix to a new n*n size, and clears all the cells.
+  void recreate(uint32_t n) {
+    N = n;
+    dense.clear();
+    sparse.clear();
+    if (usingDenseStorage()) {
+      dense.resize((uint64_t(N) * (N - (N > 0)) / 2 + 63) / 64);
+    }
+  }
+
+private:
+  uint32_t N = 0;
+  std::vector<uint64_t> dense;
+  std::unordered_set<uint64_t> sparse;
+
+  // The cells of each row |high| follow those of the rows before it.
+  uint64_t getCell(uint32_t low, uint32_t high) const {
+    assert(low < high);
+    assert(high < N);
+    return uint64_t(high) * (high - 1) / 2 + low;
+  }
+
+  // Calls a function on the offset of each set bit among |count| dense bits
+  // starting at |first|.
+  template<typename F>
+  void forEachBit(uint64_t first, uint32_t count, F f) const {
+    for (uint32_t offset = 0; offset < count;) {
+      auto shift = (first + offset) % 64;
+      auto chunk = std::min(uint64_t(64) - shift, uint64_t(count - offset));
+      auto bits = dense[(first + offset) / 64] >> shift;
+      if (chunk < 64) {
+        bits &= (uint64_t(1) << chunk) - 1;
+      }
+      while (bits) {
+        f(offset + Bits::countTrailingZeroes(bits));
+        bits &= bits - 1;
+      }
+      offset += chunk;
+    }
+  }
+
+  uint64_t getKey(uint32_t low, uint32_t high) const {
+    assert(low < high);
+    assert(high < N);
+    return (uint64_t(high) << 32) | low;
+  }
+};
+
+} // namespace wasm
+
+#endif // wasm_support_triangular_bit_matrix_h
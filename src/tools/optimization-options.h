@@ -236,6 +236,26 @@ struct OptimizationOptions : public ToolOptions {
              passOptions.inlining.partialInliningIfs =
                static_cast<Index>(std::stoi(argument));
            })
+      .add("--inline-bottom-up",
+           "-ibu",
+           "Inline in a single pass over the call graph, from callees to "
+           "callers, instead of iterating to a fixed point",
+           OptimizationOptionsCategory,
+           Options::Arguments::Zero,
+           [this](Options* o, const std::string&) {
+             passOptions.inlining.bottomUp = true;
+           })
+      .add("--inline-max-code-growth",
+           "-imcg",
+           "Max growth in code size from bottom-up inlining, as a percentage "
+           "of the original size (default: " +
+             std::to_string(InliningOptions().maxCodeGrowth) + ')',
+           OptimizationOptionsCategory,
+           Options::Arguments::One,
+           [this](Options* o, const std::string& argument) {
+             passOptions.inlining.maxCodeGrowth =
+               static_cast<Index>(std::stoi(argument));
+           })
       .add("--ignore-implicit-traps",
            "-iit",
            "Optimize under the helpful assumption that no surprising traps "
@@ -285,6 +305,15 @@ struct OptimizationOptions : public ToolOptions {
            Options::Arguments::One,
            [this](Options*, const std::string& pass) {
              passOptions.passesToSkip.insert(pass);
+           })
+      .add("--function-cache",
+           "",
+           "Cache the optimized functions in the given directory, and reuse "
+           "them when optimizing functions that did not change",
+           OptimizationOptionsCategory,
+           Options::Arguments::One,
+           [this](Options*, const std::string& argument) {
+             passOptions.functionCache = argument;
            });
 
     // add passes in registry
@@ -33,6 +33,7 @@
 #include "pass.h"
 #include "support/colors.h"
 #include "support/file.h"
+#include "support/paged_memory.h"
 #include "support/small_set.h"
 #include "support/string.h"
 #include "tool-options.h"
@@ -144,8 +145,9 @@ struct CtorEvalExternalInterface : EvallingModuleRunner::ExternalInterface {
   EvallingModuleRunner* instance;
   std::map<Name, std::shared_ptr<EvallingModuleRunner>> linkedInstances;
 
-  // A representation of the contents of wasm memory as we execute.
-  std::unordered_map<Name, std::vector<char>> memories;
+  // A representation of the contents of wasm memory as we execute. Its size
+  // is the extent of memory that execution accessed.
+  std::unordered_map<Name, PagedMemory> memories;
 
   CtorEvalExternalInterface(
     std::map<Name, std::shared_ptr<EvallingModuleRunner>> linkedInstances_ =
@@ -166,13 +168,64 @@ struct CtorEvalExternalInterface : EvallingModuleRunner::ExternalInterface {
     applyGlobalsToModule();
   }
 
+  // A snapshot of the state of execution. Taking one is cheap, as memory pages
+  // are shared with the snapshot until they are written to.
+  struct Checkpoint {
+    std::unordered_map<Name, PagedMemory> memories;
+    // The globals of the instance, followed by those of the linked instances.
+    std::vector<GlobalValueSet> globals;
+  };
+
+  Checkpoint checkpoint() {
+    Checkpoint ret{memories, {instance->globals}};
+    for (auto& [_, linked] : linkedInstances) {
+      ret.globals.push_back(linked->globals);
+    }
+    return ret;
+  }
+
+  void rollback(const Checkpoint& checkpoint) {
+    memories = checkpoint.memories;
+    instance->globals = checkpoint.globals[0];
+    Index i = 1;
+    for (auto& [_, linked] : linkedInstances) {
+      linked->globals = checkpoint.globals[i++];
+    }
+  }
+
+  // Called when we successfully evaluated something and want to keep the
+  // resulting state. Applying it to the module takes time proportional to the
+  // size of memory, so rather than do that each time we take a checkpoint, and
+  // apply the last one when we are done. GC data is modified in place, which
+  // a checkpoint does not capture, so with GC we apply the state right away.
+  void commit() {
+    if (wasm->features.hasGC()) {
+      applyToModule();
+    } else {
+      committed = checkpoint();
+    }
+  }
+
+  // Called when we are done evaluating. Returns to the state of the last
+  // commit, discarding anything a failed evaluation did after it, and applies
+  // it to the module.
+  void finish() {
+    if (committed) {
+      rollback(*committed);
+      applyToModule();
+      committed.reset();
+    }
+  }
+
+  // The state at the last commit(), if it was not applied to the module yet.
+  std::optional<Checkpoint> committed;
+
   void init(Module& wasm_, EvallingModuleRunner& instance_) override {
     wasm = &wasm_;
     instance = &instance_;
     for (auto& memory : wasm->memories) {
       if (!memory->imported()) {
-        std::vector<char> data;
-        memories[memory->name] = data;
+        memories[memory->name];
       }
     }
   }
@@ -408,29 +461,24 @@ struct CtorEvalExternalInterface : EvallingModuleRunner::ExternalInterface {
   }
 
 private:
-  // TODO: handle unaligned too, see shell-interface
-  template<typename T> T* getMemory(Address address, Name memoryName) {
+  PagedMemory& getMemory(Address address, size_t size, Name memoryName) {
     auto it = memories.find(memoryName);
     assert(it != memories.end());
     auto& memory = it->second;
-    // resize the memory buffer as needed.
-    auto max = address + sizeof(T);
+    // extend the accessed extent of memory as needed.
+    auto max = address + size;
     if (max > memory.size()) {
       memory.resize(max);
     }
-    return (T*)(&memory[address]);
+    return memory;
   }
 
   template<typename T> void doStore(Address address, T value, Name memoryName) {
-    // do a memcpy to avoid undefined behavior if unaligned
-    memcpy(getMemory<T>(address, memoryName), &value, sizeof(T));
+    getMemory(address, sizeof(T), memoryName).set(address, value);
   }
 
   template<typename T> T doLoad(Address address, Name memoryName) {
-    // do a memcpy to avoid undefined behavior if unaligned
-    T ret;
-    memcpy(&ret, getMemory<T>(address, memoryName), sizeof(T));
-    return ret;
+    return getMemory(address, sizeof(T), memoryName).get<T>(address);
   }
 
   // Clear the state of the operation of applying the interpreter's runtime
@@ -465,7 +513,9 @@ private:
 
     // Copy the current memory contents after execution into the Module's
     // memory.
-    segment->data = memories[wasm->memories[0]->name];
+    auto& memory = memories[wasm->memories[0]->name];
+    segment->data.resize(memory.size());
+    memory.read(0, segment->data.data(), memory.size());
   }
 
   // Serializing GC data requires more work than linear memory, because
@@ -689,7 +739,7 @@ EvalCtorOutcome evalCtor(EvallingModuleRunner& instance,
     EvallingModuleRunner::FunctionScope scope(func, params, instance);
 
     // After we successfully eval a line we will apply the changes here. This is
-    // the same idea as applyToModule() - we must only do it after an entire
+    // the same idea as commit() - we must only do it after an entire
     // atomic "chunk" has been processed, we do not want partial updates from
     // an item in the block that we only partially evalled.
     std::vector<Literals> appliedLocals;
@@ -712,8 +762,8 @@ EvalCtorOutcome evalCtor(EvallingModuleRunner& instance,
         break;
       }
 
-      // So far so good! Apply the results.
-      interface.applyToModule();
+      // So far so good! Keep the results.
+      interface.commit();
       appliedLocals = scope.locals;
       successes++;
 
@@ -799,8 +849,8 @@ EvalCtorOutcome evalCtor(EvallingModuleRunner& instance,
     return EvalCtorOutcome();
   }
 
-  // Success! Apply the results.
-  interface.applyToModule();
+  // Success! Keep the results.
+  interface.commit();
   return EvalCtorOutcome(results);
 }
 
@@ -824,6 +874,9 @@ void evalCtors(Module& wasm,
   try {
     // create an instance for evalling
     EvallingModuleRunner instance(wasm, &interface, linkedInstances);
+    // Startup code can run for a long time, so execute it as bytecode. Our
+    // only customization, of reads of imported globals, is still honored.
+    instance.setPrecompile(true);
     // go one by one, in order, until we fail
     // TODO: if we knew priorities, we could reorder?
     for (auto& ctor : ctors) {
@@ -836,6 +889,7 @@ void evalCtors(Module& wasm,
       auto outcome = evalCtor(instance, interface, funcName, ctor);
       if (!outcome) {
         std::cout << "  ...stopping\n";
+        interface.finish();
         return;
       }
 
@@ -860,6 +914,7 @@ void evalCtors(Module& wasm,
         wasm.getExport(exp->name)->value = copyName;
       }
     }
+    interface.finish();
   } catch (FailToEvalException& fail) {
     // that's it, we failed to even create the instance
     std::cout << "  ...stopping since could not create module instance: "
@@ -0,0 +1,425 @@
+/*
+ * Copyright 2023 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Fuzzes the optimizer in process, on all cores. Each worker builds a module
+// from random bytes, like wasm-opt -ttf, runs the given passes on it, and
+// compares the results of executing it in the interpreter before and after,
+// like wasm-opt --fuzz-exec. That avoids the cost of starting a process and
+// of writing and reading modules for each testcase.
+//
+// The random bytes come from a corpus that we mutate. When binaryen is built
+// with clang's -fsanitize-coverage=trace-pc-guard, inputs that reach code
+// that was not reached before are added to the corpus, which steers the
+// fuzzing towards new code paths. Otherwise the corpus stays as it was loaded.
+//
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "execution-results.h"
+#include "fuzzing.h"
+#include "optimization-options.h"
+#include "support/threads.h"
+#include "wasm-validator.h"
+
+// Coverage feedback, using the callbacks of clang's
+// -fsanitize-coverage=trace-pc-guard. Each edge in the instrumented code has a
+// guard that we initialize to 1, and which we clear the first time the edge is
+// reached, so that each edge is counted once and later visits are cheap.
+
+static std::atomic<size_t> totalEdges(0);
+static std::atomic<size_t> coveredEdges(0);
+
+// The number of new edges reached by the current thread.
+static thread_local size_t newEdges = 0;
+
+extern "C" void __sanitizer_cov_trace_pc_guard_init(uint32_t* start,
+                                                    uint32_t* stop) {
+  if (start == stop || *start) {
+    return;
+  }
+  for (auto* guard = start; guard < stop; guard++) {
+    *guard = 1;
+  }
+  totalEdges += stop - start;
+}
+
+extern "C" void __sanitizer_cov_trace_pc_guard(uint32_t* guard) {
+  if (!*guard) {
+    return;
+  }
+#if defined(__GNUC__)
+  if (!__atomic_exchange_n(guard, 0, __ATOMIC_RELAXED)) {
+    return;
+  }
+#else
+  *guard = 0;
+#endif
+  newEdges++;
+  coveredEdges++;
+}
+
+namespace wasm {
+
+using RandEngine = std::mt19937_64;
+using Input = std::vector<char>;
+
+uint64_t getSeed() {
+  // Return a (truly) random 64-bit value.
+  std::random_device rand;
+  return std::uniform_int_distribution<uint64_t>{}(rand);
+}
+
+// Discards everything written to it. The interpreter logs to stdout, which
+// from many threads at once would be both noise and slow.
+struct NullBuffer : public std::streambuf {
+  int overflow(int c) override { return traits_type::not_eof(c); }
+  std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+struct Fuzzer {
+  OptimizationOptions& options;
+
+  // Where to save inputs that add coverage, if anywhere.
+  std::string corpusDir;
+
+  // Where to save inputs that find bugs.
+  std::string failureDir;
+
+  // The size of the fresh random inputs we generate.
+  size_t inputSize;
+
+  bool allowMemory;
+  bool allowOOB;
+
+  std::mutex corpusMutex;
+  std::vector<Input> corpus;
+
+  // The number of iterations that were started, and that are done.
+  std::atomic<size_t> started{0};
+  std::atomic<size_t> iterations{0};
+  std::atomic<size_t> failures{0};
+
+  Fuzzer(OptimizationOptions& options,
+         std::string corpusDir,
+         std::string failureDir,
+         size_t inputSize,
+         bool allowMemory,
+         bool allowOOB)
+    : options(options), corpusDir(corpusDir), failureDir(failureDir),
+      inputSize(inputSize), allowMemory(allowMemory), allowOOB(allowOOB) {}
+
+  void loadCorpus() {
+    if (corpusDir.empty() || !std::filesystem::exists(corpusDir)) {
+      return;
+    }
+    for (auto& entry : std::filesystem::directory_iterator(corpusDir)) {
+      if (entry.is_regular_file()) {
+        corpus.push_back(
+          read_file<Input>(entry.path().string(), Flags::Binary));
+      }
+    }
+  }
+
+  // Runs |count| iterations, or forever if it is zero.
+  void work(uint64_t seed, size_t count) {
+    RandEngine rand(seed);
+    while (!count || started++ < count) {
+      auto input = pickInput(rand);
+      newEdges = 0;
+      if (auto failure = check(input)) {
+        failures++;
+        auto file = save(failureDir, "failure-", input);
+        std::cerr << "[wasm-fuzz-exec] " << *failure << ", saved the input to "
+                  << file << " (run wasm-opt on it with -ttf --fuzz-exec and "
+                  << "the same passes to reproduce)\n";
+      }
+      if (newEdges) {
+        {
+          std::lock_guard<std::mutex> lock(corpusMutex);
+          corpus.push_back(input);
+        }
+        if (!corpusDir.empty()) {
+          save(corpusDir, "", input);
+        }
+      }
+      iterations++;
+    }
+  }
+
+  // Generates a module from an input, optimizes it, and returns what went
+  // wrong, if anything.
+  std::optional<std::string> check(const Input& input) {
+    Module wasm;
+    options.applyFeatures(wasm);
+    TranslateToFuzzReader reader(wasm, Input(input));
+    reader.setAllowMemory(allowMemory);
+    reader.setAllowOOB(allowOOB);
+    reader.build();
+    if (!WasmValidator().validate(wasm, options.passOptions)) {
+      return "invalid module after translate-to-fuzz";
+    }
+    ExecutionResults before;
+    before.get(wasm);
+    options.runPasses(wasm);
+    if (!WasmValidator().validate(wasm, options.passOptions)) {
+      return "invalid module after optimization";
+    }
+    ExecutionResults after;
+    after.get(wasm);
+    if (after != before) {
+      return "optimization passes changed results";
+    }
+    return {};
+  }
+
+  Input pickInput(RandEngine& rand) {
+    Input input;
+    {
+      std::lock_guard<std::mutex> lock(corpusMutex);
+      // Now and then, and always when we have nothing to mutate, start over
+      // from fresh random bytes.
+      if (corpus.empty() || rand() % 8 == 0) {
+        input.resize(inputSize);
+        for (auto& c : input) {
+          c = rand();
+        }
+        return input;
+      }
+      input = corpus[rand() % corpus.size()];
+      if (rand() % 4 == 0) {
+        // Splice in the end of another input.
+        auto& other = corpus[rand() % corpus.size()];
+        input.resize(rand() % (input.size() + 1));
+        auto start = other.begin() + rand() % (other.size() + 1);
+        input.insert(input.end(), start, other.end());
+      }
+    }
+    auto mutations = 1 + rand() % 4;
+    for (size_t i = 0; i < mutations; i++) {
+      mutate(input, rand);
+    }
+    return input;
+  }
+
+  void mutate(Input& input, RandEngine& rand) {
+    if (input.empty()) {
+      input.push_back(rand());
+      return;
+    }
+    auto pos = rand() % input.size();
+    auto len = std::min(size_t(1 + rand() % 64), input.size() - pos);
+    switch (rand() % 5) {
+      case 0:
+        // Flip a bit.
+        input[pos] ^= 1 << (rand() % 8);
+        break;
+      case 1:
+        // Overwrite a range with random bytes.
+        for (size_t i = 0; i < len; i++) {
+          input[pos + i] = rand();
+        }
+        break;
+      case 2: {
+        // Insert random bytes.
+        Input bytes(len);
+        for (auto& c : bytes) {
+          c = rand();
+        }
+        input.insert(input.begin() + pos, bytes.begin(), bytes.end());
+        break;
+      }
+      case 3:
+        // Remove a range.
+        input.erase(input.begin() + pos, input.begin() + pos + len);
+        break;
+      case 4: {
+        // Duplicate a range.
+        Input bytes(input.begin() + pos, input.begin() + pos + len);
+        input.insert(input.begin() + rand() % input.size(),
+                     bytes.begin(),
+                     bytes.end());
+        break;
+      }
+    }
+  }
+
+  std::string
+  save(const std::string& dir, const std::string& prefix, const Input& input) {
+    std::stringstream name;
+    name << prefix << std::hex
+         << std::hash<std::string_view>{}({input.data(), input.size()});
+    auto file = (std::filesystem::path(dir) / name.str()).string();
+    std::ofstream out(file, std::ios::binary);
+    out.write(input.data(), input.size());
+    return file;
+  }
+};
+
+} // namespace wasm
+
+int main(int argc, const char* argv[]) {
+  using namespace wasm;
+
+  const std::string WasmFuzzExecOption = "wasm-fuzz-exec options";
+
+  std::optional<uint64_t> seed;
+  size_t workers = ThreadPool::getNumCores();
+  size_t iterations = 0;
+  std::string corpusDir;
+  std::string failureDir = ".";
+  size_t inputSize = 4096;
+  bool allowMemory = true;
+  bool allowOOB = true;
+
+  OptimizationOptions options(
+    "wasm-fuzz-exec",
+    "Fuzz the given optimization passes in process, comparing the results of "
+    "execution before and after them");
+  options
+    .add("--seed",
+         "",
+         "The seed of the random generator, for reproducibility (when using a "
+         "single worker)",
+         WasmFuzzExecOption,
+         Options::Arguments::One,
+         [&](Options*, const std::string& arg) {
+           seed = uint64_t(std::stoull(arg));
+         })
+    .add("--workers",
+         "-w",
+         "How many threads to fuzz on (default: the number of cores)",
+         WasmFuzzExecOption,
+         Options::Arguments::One,
+         [&](Options*, const std::string& arg) {
+           workers = std::max(std::stoi(arg), 1);
+         })
+    .add("--iterations",
+         "-n",
+         "How many testcases to run in total (default: run forever)",
+         WasmFuzzExecOption,
+         Options::Arguments::One,
+         [&](Options*, const std::string& arg) {
+           iterations = std::stoull(arg);
+         })
+    .add("--corpus",
+         "",
+         "A directory of inputs to start from, where we also save the inputs "
+         "that reach new code",
+         WasmFuzzExecOption,
+         Options::Arguments::One,
+         [&](Options*, const std::string& arg) { corpusDir = arg; })
+    .add("--failures",
+         "",
+         "The directory to save inputs that find bugs to (default: .)",
+         WasmFuzzExecOption,
+         Options::Arguments::One,
+         [&](Options*, const std::string& arg) { failureDir = arg; })
+    .add("--input-size",
+         "",
+         "The size of fresh random inputs (default: 4096)",
+         WasmFuzzExecOption,
+         Options::Arguments::One,
+         [&](Options*, const std::string& arg) {
+           inputSize = std::stoull(arg);
+         })
+    .add("--no-fuzz-memory",
+         "",
+         "don't emit memory ops when fuzzing",
+         WasmFuzzExecOption,
+         Options::Arguments::Zero,
+         [&](Options*, const std::string&) { allowMemory = false; })
+    .add("--no-fuzz-oob",
+         "",
+         "don't emit out-of-bounds loads/stores/indirect calls when fuzzing",
+         WasmFuzzExecOption,
+         Options::Arguments::Zero,
+         [&](Options*, const std::string&) { allowOOB = false; });
+  options.parse(argc, argv);
+
+  if (!options.runningPasses()) {
+    Fatal() << "no passes specified";
+  }
+
+  // Each worker optimizes on its own thread, so the passes should not use
+  // more.
+  ThreadPool::setNumCores(1);
+
+  Fuzzer fuzzer(
+    options, corpusDir, failureDir, inputSize, allowMemory, allowOOB);
+  fuzzer.loadCorpus();
+  std::cerr << "[wasm-fuzz-exec] loaded " << fuzzer.corpus.size()
+            << " inputs\n";
+  if (!totalEdges) {
+    std::cerr << "[wasm-fuzz-exec] no coverage instrumentation, so the corpus "
+                 "will not grow\n";
+  }
+
+  NullBuffer nullBuffer;
+  auto* stdoutBuffer = std::cout.rdbuf(&nullBuffer);
+
+  RandEngine nextSeed(seed ? *seed : getSeed());
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < workers; i++) {
+    threads.emplace_back(
+      [&fuzzer, iterations, seed = nextSeed()]() {
+        fuzzer.work(seed, iterations);
+      });
+  }
+
+  // Report progress every few seconds while the workers run, and at the end.
+  auto start = std::chrono::steady_clock::now();
+  auto report = [&]() {
+    std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+    size_t runs = fuzzer.iterations;
+    size_t corpusSize;
+    {
+      std::lock_guard<std::mutex> lock(fuzzer.corpusMutex);
+      corpusSize = fuzzer.corpus.size();
+    }
+    std::cerr << "[wasm-fuzz-exec] " << runs << " runs ("
+              << size_t(runs / elapsed.count()) << "/s), corpus " << corpusSize
+              << ", coverage " << coveredEdges << '/' << totalEdges
+              << ", failures " << fuzzer.failures << '\n';
+  };
+  std::atomic<bool> done(false);
+  std::thread reporter([&]() {
+    size_t ticks = 0;
+    while (!done) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      if (++ticks % 50 == 0) {
+        report();
+      }
+    }
+  });
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  done = true;
+  reporter.join();
+  report();
+
+  std::cout.rdbuf(stdoutBuffer);
+  return fuzzer.failures ? 1 : 0;
+}
@@ -23,13 +23,18 @@
 // much more debuggable manner).
 //
 
+#include <atomic>
+#include <cctype>
 #include <cstdio>
 #include <cstdlib>
 #include <memory>
+#include <thread>
 
+#include "execution-results.h"
 #include "ir/branch-utils.h"
 #include "ir/iteration.h"
 #include "ir/literal-utils.h"
+#include "ir/module-utils.h"
 #include "ir/properties.h"
 #include "pass.h"
 #include "support/colors.h"
@@ -37,6 +42,7 @@
 #include "support/file.h"
 #include "support/hash.h"
 #include "support/path.h"
+#include "support/string.h"
 #include "support/timing.h"
 #include "tool-options.h"
 #include "wasm-builder.h"
@@ -80,6 +86,27 @@ static size_t timeout = 2;
 // default of enabling all features should work in most cases.
 static std::string extraFlags = "-all";
 
+// How many candidates to test in parallel, where we can.
+static size_t jobs = 1;
+
+// A built-in test to use instead of the command. It is run on the module in
+// memory, which avoids writing it out, forking and reading it back in for each
+// reduction we try.
+enum class Oracle {
+  // Use the command.
+  None,
+  // Check whether the module validates after running the oracle passes.
+  Validate,
+  // Check whether the oracle passes change the results of executing the
+  // module in the interpreter, like wasm-opt --fuzz-exec.
+  FuzzExec
+};
+
+static Oracle oracle = Oracle::None;
+
+// The passes the oracle runs.
+static std::vector<std::string> oraclePasses;
+
 struct ProgramResult {
   int code;
   std::string output;
@@ -199,6 +226,81 @@ struct ProgramResult {
   }
 #endif // _WIN32
 
+  // Computes the result of the oracle on a module, leaving it unchanged.
+  void getFromModule(Module& wasm) {
+    Timer timer;
+    timer.start();
+    code = 0;
+    output.clear();
+    // The interpreter logs to stdout, which is just noise here. Restore it
+    // however we leave, as the oracle passes may throw.
+    struct StdoutSilencer {
+      std::streambuf* buffer = std::cout.rdbuf(nullptr);
+      ~StdoutSilencer() {
+        std::cout.rdbuf(buffer);
+        std::cout.clear();
+      }
+    } silencer;
+    if (!WasmValidator().validate(
+          wasm, WasmValidator::Globally | WasmValidator::Quiet)) {
+      code = 1;
+      output = "invalid input\n";
+    } else {
+      Module copy;
+      ModuleUtils::copyModule(wasm, copy);
+      ExecutionResults before;
+      if (oracle == Oracle::FuzzExec) {
+        before.get(copy);
+      }
+      PassRunner runner(&copy);
+      for (auto& pass : oraclePasses) {
+        runner.add(pass);
+      }
+      runner.run();
+      if (!WasmValidator().validate(
+            copy, WasmValidator::Globally | WasmValidator::Quiet)) {
+        code = 1;
+        output = "invalid after passes\n";
+      } else if (oracle == Oracle::FuzzExec) {
+        ExecutionResults after;
+        after.get(copy);
+        if (after != before) {
+          code = 1;
+          output = "[fuzz-exec] optimization passes changed results\n";
+        }
+      }
+    }
+    timer.stop();
+    time = timer.getTotal();
+  }
+
+  // Computes the result on a file: using the oracle if there is one, and
+  // otherwise by running the command, which should read the file. The module
+  // gets the same features as the working module does when reducing.
+  void getFromFile(const std::string& file,
+                   const std::string& command,
+                   ToolOptions& toolOptions) {
+    if (oracle == Oracle::None) {
+      getFromExecution(command);
+      return;
+    }
+    Module wasm;
+    try {
+      ModuleReader().read(file, wasm);
+    } catch (ParseException&) {
+      code = 1;
+      output = "parse error\n";
+      time = 0;
+      return;
+    }
+    // As when reducing, assume we may need all features if none are listed.
+    if (!wasm.hasFeaturesSection) {
+      wasm.features = FeatureSet::All;
+    }
+    toolOptions.applyFeatures(wasm);
+    getFromModule(wasm);
+  }
+
   bool operator==(ProgramResult& other) {
     return code == other.code && output == other.output;
   }
@@ -223,6 +325,90 @@ inline std::ostream& operator<<(std::ostream& o, ProgramResult& result) {
 
 ProgramResult expected;
 
+// Runs the commands, up to |jobs| of them at once, and returns their results
+// in order.
+static std::vector<ProgramResult>
+runInParallel(const std::vector<std::string>& commands) {
+  std::vector<ProgramResult> results(commands.size());
+  std::atomic<size_t> next(0);
+  auto work = [&]() {
+    size_t i;
+    while ((i = next++) < commands.size()) {
+      results[i].getFromExecution(commands[i]);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < std::min(jobs, commands.size()); i++) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return results;
+}
+
+// Returns the file that candidate |i| of a parallel batch is written to. The
+// first is the test file itself, so that running one candidate at a time
+// behaves as it always did.
+static std::string getCandidateFile(const std::string& test, size_t i) {
+  if (i == 0) {
+    return test;
+  }
+  // Keep the extension, as it may matter to the command.
+  auto dot = test.rfind('.');
+  auto sep = test.find_last_of("/\\");
+  if (dot == std::string::npos || (sep != std::string::npos && dot < sep)) {
+    dot = test.size();
+  }
+  return test.substr(0, dot) + ".job" + std::to_string(i) + test.substr(dot);
+}
+
+// Returns where the command next refers to the test file, at or after |start|,
+// or std::string::npos if it does not. Only whole words of the command count,
+// possibly in quotes, or after a directory, so that a test file named "t.wasm"
+// is not found inside "out.wasm" or "t.wasm.map".
+static size_t findTestFile(const std::string& command,
+                           const std::string& test,
+                           size_t start = 0) {
+  if (test.empty()) {
+    return std::string::npos;
+  }
+  auto isSpace = [](char c) { return isspace((unsigned char)c) != 0; };
+  auto isQuote = [](char c) { return c == '"' || c == '\''; };
+  size_t found;
+  while ((found = command.find(test, start)) != std::string::npos) {
+    auto end = found + test.size();
+    bool atStart = found == 0 || isSpace(command[found - 1]) ||
+                   isQuote(command[found - 1]) || command[found - 1] == '/';
+    bool atEnd = end == command.size() || isSpace(command[end]) ||
+                 isQuote(command[end]);
+    if (atStart && atEnd) {
+      return found;
+    }
+    start = found + 1;
+  }
+  return std::string::npos;
+}
+
+// Returns the command that tests candidate |i|, by having it refer to the
+// candidate's file instead of the test file.
+static std::string getCandidateCommand(const std::string& command,
+                                       const std::string& test,
+                                       size_t i) {
+  if (i == 0) {
+    return command;
+  }
+  auto file = getCandidateFile(test, i);
+  std::string ret;
+  size_t start = 0, found;
+  while ((found = findTestFile(command, test, start)) != std::string::npos) {
+    ret += command.substr(start, found - start) + file;
+    start = found + test.size();
+  }
+  return ret + command.substr(start);
+}
+
 // Removing functions is extremely beneficial and efficient. We aggressively
 // try to remove functions, unless we've seen they can't be removed, in which
 // case we may try again but much later.
@@ -294,28 +480,59 @@ struct Reducer
       // std::cerr << "|    starting passes loop iteration\n";
       more = false;
       // try both combining with a generic shrink (so minor pass overhead is
-      // compensated for), and without
-      for (auto pass : passes) {
-        std::string currCommand = Path::getBinaryenBinaryTool("wasm-opt") + " ";
-        currCommand += working + " -o " + test + " " + pass + " " + extraFlags;
-        if (!binary) {
-          currCommand += " -S ";
+      // compensated for), and without. The passes are independent of each
+      // other, so we try a batch of them at once, and keep the first in the
+      // batch that works.
+      for (size_t start = 0; start < passes.size(); start += jobs) {
+        auto end = std::min(passes.size(), start + jobs);
+        std::vector<std::string> passCommands;
+        for (size_t i = start; i < end; i++) {
+          std::string currCommand =
+            Path::getBinaryenBinaryTool("wasm-opt") + " ";
+          currCommand += working + " -o " + getCandidateFile(test, i - start) +
+                         " " + passes[i] + " " + extraFlags;
+          if (!binary) {
+            currCommand += " -S ";
+          }
+          if (verbose) {
+            std::cerr << "|    trying pass command: " << currCommand << "\n";
+          }
+          passCommands.push_back(currCommand);
         }
-        if (verbose) {
-          std::cerr << "|    trying pass command: " << currCommand << "\n";
+        auto passResults = runInParallel(passCommands);
+        // The candidates that did not fail, and whose size looks smaller, are
+        // promising. See if they still have the property we are preserving.
+        std::vector<size_t> promising;
+        std::vector<std::string> testCommands;
+        for (size_t i = 0; i < passResults.size(); i++) {
+          if (!passResults[i].failed() &&
+              file_size(getCandidateFile(test, i)) < oldSize) {
+            promising.push_back(i);
+            testCommands.push_back(getCandidateCommand(command, test, i));
+          }
         }
-        if (!ProgramResult(currCommand).failed()) {
-          auto newSize = file_size(test);
-          if (newSize < oldSize) {
-            // the pass didn't fail, and the size looks smaller, so promising
-            // see if it is still has the property we are preserving
-            if (ProgramResult(command) == expected) {
-              std::cerr << "|    command \"" << currCommand
-                        << "\" succeeded, reduced size to " << newSize << '\n';
-              copy_file(test, working);
-              more = true;
-              oldSize = newSize;
-            }
+        std::vector<ProgramResult> testResults;
+        if (oracle == Oracle::None) {
+          testResults = runInParallel(testCommands);
+        } else {
+          // The oracle runs in this process, one candidate at a time.
+          for (auto i : promising) {
+            testResults.emplace_back();
+            testResults.back().getFromFile(
+              getCandidateFile(test, i), command, toolOptions);
+          }
+        }
+        for (size_t j = 0; j < testResults.size(); j++) {
+          if (testResults[j] == expected) {
+            auto i = promising[j];
+            auto candidate = getCandidateFile(test, i);
+            auto newSize = file_size(candidate);
+            std::cerr << "|    command \"" << passCommands[i]
+                      << "\" succeeded, reduced size to " << newSize << '\n';
+            copy_file(candidate, working);
+            more = true;
+            oldSize = newSize;
+            break;
           }
         }
       }
@@ -400,8 +617,9 @@ struct Reducer
     // than the previous - each destructive reduction removes logical code,
     // and so is strictly better, even if the wasm binary format happens to
     // encode things slightly less efficiently.
-    // test it
-    out.getFromExecution(command);
+    // test it. An oracle reads the file back rather than looking at the module
+    // in memory, so that it tests exactly what we keep if this succeeds.
+    out.getFromFile(test, command, toolOptions);
     return out == expected;
   }
 
@@ -1271,6 +1489,50 @@ int main(int argc, const char* argv[]) {
            timeout = atoi(argument.c_str());
            std::cout << "|applying timeout: " << timeout << "\n";
          })
+    .add("--jobs",
+         "-j",
+         "How many candidate reductions to test in parallel, where possible "
+         "(default: 1). The command must refer to the test file by name, so "
+         "that it can be pointed at the file of each candidate. A command "
+         "that writes to fixed scratch files is unsafe with more than one "
+         "job, as the candidates would overwrite each other's files",
+         WasmReduceOption,
+         Options::Arguments::One,
+         [&](Options* o, const std::string& argument) {
+           jobs = std::max(atoi(argument.c_str()), 1);
+           std::cout << "|applying jobs: " << jobs << "\n";
+         })
+    .add("--oracle",
+         "-or",
+         "Instead of running a command, use a built-in test in this process, "
+         "which is much faster. 'validate' checks whether the oracle "
+         "passes produce an invalid module, and 'fuzz-exec' whether they "
+         "change the results of running it in the interpreter",
+         WasmReduceOption,
+         Options::Arguments::One,
+         [&](Options* o, const std::string& argument) {
+           if (argument == "validate") {
+             oracle = Oracle::Validate;
+           } else if (argument == "fuzz-exec") {
+             oracle = Oracle::FuzzExec;
+           } else {
+             Fatal() << "unknown oracle: " << argument;
+           }
+         })
+    .add("--oracle-passes",
+         "-op",
+         "A comma-separated list of the passes for the oracle to run",
+         WasmReduceOption,
+         Options::Arguments::One,
+         [&](Options* o, const std::string& argument) {
+           auto names = PassRegistry::get()->getRegisteredNames();
+           for (auto& pass : String::Split(argument, ",")) {
+             if (std::find(names.begin(), names.end(), pass) == names.end()) {
+               Fatal() << "unknown pass: " << pass;
+             }
+             oraclePasses.push_back(pass);
+           }
+         })
     .add("--extra-flags",
          "-ef",
          "Extra commandline flags to pass to wasm-opt while reducing. "
@@ -1305,6 +1567,16 @@ int main(int argc, const char* argv[]) {
     Fatal() << "working file not provided\n";
   }
 
+  if (oracle != Oracle::None && oraclePasses.empty()) {
+    Fatal() << "--oracle needs passes to run, given by --oracle-passes\n";
+  }
+
+  if (oracle == Oracle::None && jobs > 1 &&
+      findTestFile(command, test) == std::string::npos) {
+    Fatal() << "the command must refer to the test file (" << test
+            << ") to test candidates in parallel\n";
+  }
+
   if (!binary) {
     Colors::setEnabled(false);
   }
@@ -1320,7 +1592,7 @@ int main(int argc, const char* argv[]) {
 
   // get the expected output
   copy_file(input, test);
-  expected.getFromExecution(command);
+  expected.getFromFile(test, command, options);
 
   std::cerr << "|expected result:\n" << expected << '\n';
   std::cerr << "|!! Make sure the above is what you expect! !!\n\n";
@@ -1339,7 +1611,7 @@ int main(int argc, const char* argv[]) {
                     expected);
   }
 
-  if (!force) {
+  if (!force && oracle == Oracle::None) {
     std::cerr << "|checking that command has different behavior on different "
                  "inputs (this "
                  "verifies that the test file is used by the command)\n";
@@ -1379,7 +1651,8 @@ int main(int argc, const char* argv[]) {
     if (readWrite.failed()) {
       stopIfNotForced("failed to read and write the binary", readWrite);
     } else {
-      ProgramResult result(command);
+      ProgramResult result;
+      result.getFromFile(test, command, options);
       if (result != expected) {
         stopIfNotForced("running command on the canonicalized module should "
                         "give the same results",
@@ -1483,4 +1756,7 @@ int main(int argc, const char* argv[]) {
   }
   std::cerr << "|finished, final size: " << file_size(working) << "\n";
   copy_file(working, test); // just to avoid confusion
+  for (size_t i = 1; i < jobs; i++) {
+    std::remove(getCandidateFile(test, i).c_str());
+  }
 }
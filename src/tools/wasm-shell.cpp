@@ -45,6 +45,7 @@ Name GET("get");
 struct ShellOptions : public Options {
   Name entry;
   std::set<size_t> skipped;
+  bool precompile = false;
 
   const std::string WasmShellOption = "wasm-shell options";
 
@@ -74,6 +75,12 @@ struct ShellOptions : public Options {
                i = ending + 1;
              }
            })
+      .add("--precompile",
+           "-p",
+           "Lower functions to bytecode before running them, which is faster",
+           WasmShellOption,
+           Options::Arguments::Zero,
+           [this](Options*, const std::string&) { precompile = true; })
       .add_positional("INFILE",
                       Options::Arguments::One,
                       [](Options* o, const std::string& argument) {
@@ -98,6 +105,7 @@ protected:
       std::make_shared<ShellExternalInterface>(linkedInstances);
     auto tempInstance = std::make_shared<ModuleRunner>(
       *wasm, tempInterface.get(), linkedInstances);
+    tempInstance->setPrecompile(options.precompile);
     interfaces[wasm->name].swap(tempInterface);
     instances[wasm->name].swap(tempInstance);
   }
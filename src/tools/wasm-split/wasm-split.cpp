@@ -37,10 +37,16 @@ using namespace wasm;
 
 namespace {
 
-void parseInput(Module& wasm, const WasmSplitOptions& options) {
+// When only the module's structure is needed, and not its code, |lazy| avoids
+// decoding function bodies at all. They are then not validated either, as
+// validating them would decode them.
+void parseInput(Module& wasm,
+                const WasmSplitOptions& options,
+                bool lazy = false) {
   options.applyFeatures(wasm);
   ModuleReader reader;
   reader.setProfile(options.profile);
+  reader.setLazyFunctionBodies(lazy);
   try {
     reader.read(options.inputFiles[0], wasm);
   } catch (ParseException& p) {
@@ -52,7 +58,8 @@ void parseInput(Module& wasm, const WasmSplitOptions& options) {
                "request for silly amounts of memory)";
   }
 
-  if (options.passOptions.validate && !WasmValidator().validate(wasm)) {
+  if (options.passOptions.validate && !lazy &&
+      !WasmValidator().validate(wasm)) {
     Fatal() << "error validating input";
   }
 }
@@ -435,8 +442,10 @@ void printReadableProfile(const WasmSplitOptions& options) {
   checkExists(options.profileFile);
   checkExists(wasmFile);
 
+  // Only the names of the functions are printed, so their bodies are not
+  // needed.
   Module wasm;
-  parseInput(wasm, options);
+  parseInput(wasm, options, /*lazy=*/true);
 
   std::set<Name> keepFuncs;
   std::set<Name> splitFuncs;
@@ -22,6 +22,7 @@
 #define wasm_wasm_binary_h
 
 #include <cassert>
+#include <functional>
 #include <ostream>
 #include <type_traits>
 
@@ -1271,7 +1272,9 @@ class WasmBinaryWriter {
 
 public:
   WasmBinaryWriter(Module* input, BufferWithRandomAccess& o)
-    : wasm(input), o(o), indexes(*input) {
+    : wasm(input), o(o), tables(std::make_unique<Tables>(*input)),
+      indexes(tables->indexes), indexedTypes(tables->indexedTypes),
+      stringIndexes(tables->stringIndexes) {
     prepare();
   }
 
@@ -1297,6 +1300,12 @@ public:
     sourceMapUrl = url;
   }
   void setSymbolMap(std::string set) { symbolMap = set; }
+  // Sets a function to which the output is handed as each top-level section is
+  // finished, after which the writer no longer keeps it in memory. Without
+  // this, the entire binary is kept in the buffer given to the constructor.
+  void setStreamingOutput(std::function<void(const uint8_t*, size_t)> set) {
+    streamingOutput = set;
+  }
 
   void write();
   void writeHeader();
@@ -1305,6 +1314,7 @@ public:
     Address initial, Address maximum, bool hasMaximum, bool shared, bool is64);
   template<typename T> int32_t startSection(T code);
   void finishSection(int32_t start);
+  void flush();
   int32_t startSubsection(BinaryConsts::CustomSections::Subsection code);
   void finishSubsection(int32_t start);
   void writeStart();
@@ -1315,6 +1325,8 @@ public:
   void writeFunctionSignatures();
   void writeExpression(Expression* curr);
   void writeFunctions();
+  void writeFunctionsInParallel();
+  void writeFunctionBody(Function* func, bool DWARF);
   void writeStrings();
   void writeGlobals();
   void writeExports();
@@ -1380,8 +1392,22 @@ public:
 private:
   Module* wasm;
   BufferWithRandomAccess& o;
-  BinaryIndexes indexes;
-  ModuleUtils::IndexedHeapTypes indexedTypes;
+
+  // The indexes of things in the binary. The writer of the module computes
+  // them and owns the tables. The writers it creates to write functions in
+  // parallel refer to the same tables rather than copying them.
+  struct Tables {
+    BinaryIndexes indexes;
+    ModuleUtils::IndexedHeapTypes indexedTypes;
+    // Indexes in the string literal section of each StringConst in the wasm.
+    std::unordered_map<Name, Index> stringIndexes;
+
+    Tables(Module& wasm) : indexes(wasm) {}
+  };
+  std::unique_ptr<Tables> tables;
+  const BinaryIndexes& indexes;
+  const ModuleUtils::IndexedHeapTypes& indexedTypes;
+  const std::unordered_map<Name, Index>& stringIndexes;
 
   bool debugInfo = true;
 
@@ -1397,6 +1423,13 @@ private:
 
   MixedArena allocator;
 
+  std::function<void(const uint8_t*, size_t)> streamingOutput;
+  // The number of bytes already handed to the streaming output. Positions in
+  // the buffer are relative to this.
+  size_t flushedBytes = 0;
+  // The number of sections and subsections we are in the middle of writing.
+  size_t sectionDepth = 0;
+
   // storage of source map locations until the section is placed at its final
   // location (shrinking LEBs may cause changes there)
   std::vector<std::pair<size_t, const Function::DebugLocation*>>
@@ -1419,21 +1452,28 @@ private:
   // info here, and then use it when writing the names.
   std::unordered_map<Name, MappedLocals> funcMappedLocals;
 
-  // Indexes in the string literal section of each StringConst in the wasm.
-  std::unordered_map<Name, Index> stringIndexes;
-
   void prepare();
+
+  // Creates a writer that emits function bodies into a buffer of its own,
+  // using the indexes the parent computed. This is used to write functions in
+  // parallel.
+  WasmBinaryWriter(const WasmBinaryWriter& parent, BufferWithRandomAccess& o)
+    : wasm(parent.wasm), o(o), indexes(parent.indexes),
+      indexedTypes(parent.indexedTypes), stringIndexes(parent.stringIndexes),
+      debugInfo(parent.debugInfo), sourceMap(parent.sourceMap) {}
 };
 
 class WasmBinaryBuilder {
   Module& wasm;
   MixedArena& allocator;
-  const std::vector<char>& input;
+  // The binary being read, which is not owned by us and must outlive us.
+  std::string_view input;
   std::istream* sourceMap;
   std::pair<uint32_t, Function::DebugLocation> nextDebugLocation;
   bool debugInfo = true;
   bool DWARF = false;
   bool skipFunctionBodies = false;
+  bool lazyFunctionBodies = false;
 
   size_t pos = 0;
   Index startIndex = -1;
@@ -1448,13 +1488,26 @@ class WasmBinaryBuilder {
 public:
   WasmBinaryBuilder(Module& wasm,
                     FeatureSet features,
-                    const std::vector<char>& input);
+                    std::string_view input);
+  WasmBinaryBuilder(Module& wasm,
+                    FeatureSet features,
+                    const std::vector<char>& input)
+    : WasmBinaryBuilder(wasm, features, {input.data(), input.size()}) {}
 
   void setDebugInfo(bool value) { debugInfo = value; }
   void setDWARF(bool value) { DWARF = value; }
   void setSkipFunctionBodies(bool skipFunctionBodies_) {
     skipFunctionBodies = skipFunctionBodies_;
   }
+  // In lazy mode the code of function bodies is only decoded when the body is
+  // first needed, see Function::materialize. Until then a copy of the code
+  // section is kept. Lazy functions must be materialized before other module
+  // elements are added, removed or reordered, as their code refers to those by
+  // index. This has no effect when reading DWARF or a source map, which need to
+  // be read in order.
+  void setLazyFunctionBodies(bool lazyFunctionBodies_) {
+    lazyFunctionBodies = lazyFunctionBodies_;
+  }
   void read();
   void readCustomSection(size_t payloadLen);
 
@@ -1557,8 +1610,29 @@ public:
   void requireFunctionContext(const char* error);
 
   void readFunctions();
+  // Decode the bodies in the code section on multiple threads, once their
+  // ranges are known, and then add the functions in order.
+  void readFunctionsInParallel(size_t total);
+  // Reads a function body ending at endOfFunction, and its locals.
+  void readFunctionBody(Function* func, bool isStart);
+  // Reads the code of a function body, after its locals.
+  void readFunctionCode(Function* func, bool isStart);
   void readVars();
 
+  // Creates a reader for function bodies in the given code, with the
+  // module-level state needed to decode them copied from this reader.
+  std::unique_ptr<WasmBinaryBuilder> makeFunctionReader(std::string_view code);
+
+  // The functions whose code we have not decoded yet, in lazy mode.
+  struct LazyFunction {
+    Function* func;
+    size_t start;
+    size_t end;
+  };
+  std::vector<LazyFunction> lazyFunctions;
+  void setUpLazyFunctions();
+  friend struct LazyFunctionReader;
+
   std::map<Export*, Index> exportIndices;
   std::vector<Export*> exportOrder;
   void readExports();
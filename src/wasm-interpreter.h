@@ -149,9 +149,11 @@ public:
 // Execute an expression
 template<typename SubType>
 class ExpressionRunner : public OverriddenVisitor<SubType, Flow> {
+protected:
+  // Children are visited through this, so that a subclass that overrides
+  // visit() sees every expression that is evaluated.
   SubType* self() { return static_cast<SubType*>(this); }
 
-protected:
   // Optional module context to search for globals and called functions. NULL if
   // we are not interested in any context.
   Module* module = nullptr;
@@ -239,7 +241,7 @@ public:
           // one of the block recursions we already handled
           continue;
         }
-        flow = visit(list[i]);
+        flow = self()->visit(list[i]);
         if (flow.breaking()) {
           flow.clearIf(curr->name);
           break;
@@ -250,20 +252,20 @@ public:
   }
   Flow visitIf(If* curr) {
     NOTE_ENTER("If");
-    Flow flow = visit(curr->condition);
+    Flow flow = self()->visit(curr->condition);
     if (flow.breaking()) {
       return flow;
     }
     NOTE_EVAL1(flow.values);
     if (flow.getSingleValue().geti32()) {
-      Flow flow = visit(curr->ifTrue);
+      Flow flow = self()->visit(curr->ifTrue);
       if (!flow.breaking() && !curr->ifFalse) {
         flow = Flow(); // if_else returns a value, but if does not
       }
       return flow;
     }
     if (curr->ifFalse) {
-      return visit(curr->ifFalse);
+      return self()->visit(curr->ifFalse);
     }
     return Flow();
   }
@@ -271,7 +273,7 @@ public:
     NOTE_ENTER("Loop");
     Index loopCount = 0;
     while (1) {
-      Flow flow = visit(curr->body);
+      Flow flow = self()->visit(curr->body);
       if (flow.breaking()) {
         if (flow.breakTo == curr->name) {
           if (maxLoopIterations != NO_LIMIT &&
@@ -290,13 +292,13 @@ public:
     bool condition = true;
     Flow flow;
     if (curr->value) {
-      flow = visit(curr->value);
+      flow = self()->visit(curr->value);
       if (flow.breaking()) {
         return flow;
       }
     }
     if (curr->condition) {
-      Flow conditionFlow = visit(curr->condition);
+      Flow conditionFlow = self()->visit(curr->condition);
       if (conditionFlow.breaking()) {
         return conditionFlow;
       }
@@ -313,13 +315,13 @@ public:
     Flow flow;
     Literals values;
     if (curr->value) {
-      flow = visit(curr->value);
+      flow = self()->visit(curr->value);
       if (flow.breaking()) {
         return flow;
       }
       values = flow.values;
     }
-    flow = visit(curr->condition);
+    flow = self()->visit(curr->condition);
     if (flow.breaking()) {
       return flow;
     }
@@ -344,7 +346,7 @@ public:
 
   Flow visitUnary(Unary* curr) {
     NOTE_ENTER("Unary");
-    Flow flow = visit(curr->value);
+    Flow flow = self()->visit(curr->value);
     if (flow.breaking()) {
       return flow;
     }
@@ -585,12 +587,12 @@ public:
   }
   Flow visitBinary(Binary* curr) {
     NOTE_ENTER("Binary");
-    Flow flow = visit(curr->left);
+    Flow flow = self()->visit(curr->left);
     if (flow.breaking()) {
       return flow;
     }
     Literal left = flow.getSingleValue();
-    flow = visit(curr->right);
+    flow = self()->visit(curr->right);
     if (flow.breaking()) {
       return flow;
     }
@@ -1172,15 +1174,15 @@ public:
   }
   Flow visitSelect(Select* curr) {
     NOTE_ENTER("Select");
-    Flow ifTrue = visit(curr->ifTrue);
+    Flow ifTrue = self()->visit(curr->ifTrue);
     if (ifTrue.breaking()) {
       return ifTrue;
     }
-    Flow ifFalse = visit(curr->ifFalse);
+    Flow ifFalse = self()->visit(curr->ifFalse);
     if (ifFalse.breaking()) {
       return ifFalse;
     }
-    Flow condition = visit(curr->condition);
+    Flow condition = self()->visit(curr->condition);
     if (condition.breaking()) {
       return condition;
     }
@@ -1189,7 +1191,7 @@ public:
   }
   Flow visitDrop(Drop* curr) {
     NOTE_ENTER("Drop");
-    Flow value = visit(curr->value);
+    Flow value = self()->visit(curr->value);
     if (value.breaking()) {
       return value;
     }
@@ -1199,7 +1201,7 @@ public:
     NOTE_ENTER("Return");
     Flow flow;
     if (curr->value) {
-      flow = visit(curr->value);
+      flow = self()->visit(curr->value);
       if (flow.breaking()) {
         return flow;
       }
@@ -1298,7 +1300,7 @@ public:
   }
   Flow visitTupleExtract(TupleExtract* curr) {
     NOTE_ENTER("tuple.extract");
-    Flow flow = visit(curr->tuple);
+    Flow flow = self()->visit(curr->tuple);
     if (flow.breaking()) {
       return flow;
     }
@@ -1338,7 +1340,7 @@ public:
   }
   Flow visitRefIsNull(RefIsNull* curr) {
     NOTE_ENTER("RefIsNull");
-    Flow flow = visit(curr->value);
+    Flow flow = self()->visit(curr->value);
     if (flow.breaking()) {
       return flow;
     }
@@ -1353,12 +1355,12 @@ public:
   }
   Flow visitRefEq(RefEq* curr) {
     NOTE_ENTER("RefEq");
-    Flow flow = visit(curr->left);
+    Flow flow = self()->visit(curr->left);
     if (flow.breaking()) {
       return flow;
     }
     auto left = flow.getSingleValue();
-    flow = visit(curr->right);
+    flow = self()->visit(curr->right);
     if (flow.breaking()) {
       return flow;
     }
@@ -1390,7 +1392,7 @@ public:
   Flow visitRethrow(Rethrow* curr) { WASM_UNREACHABLE("unimp"); }
   Flow visitI31New(I31New* curr) {
     NOTE_ENTER("I31New");
-    Flow flow = visit(curr->value);
+    Flow flow = self()->visit(curr->value);
     if (flow.breaking()) {
       return flow;
     }
@@ -1400,7 +1402,7 @@ public:
   }
   Flow visitI31Get(I31Get* curr) {
     NOTE_ENTER("I31Get");
-    Flow flow = visit(curr->i31);
+    Flow flow = self()->visit(curr->i31);
     if (flow.breaking()) {
       return flow;
     }
@@ -1502,7 +1504,7 @@ public:
       }
     }
     // Otherwise we are just checking for null.
-    Flow flow = visit(curr->ref);
+    Flow flow = self()->visit(curr->ref);
     if (flow.breaking()) {
       return flow;
     }
@@ -1551,7 +1553,7 @@ public:
         data[i] = value.getSingleValue();
       }
     }
-    return Literal(std::make_shared<GCData>(curr->type.getHeapType(), data),
+    return Literal(makeGCData(curr->type.getHeapType(), std::move(data)),
                    curr->type.getHeapType());
   }
   Flow visitStructGet(StructGet* curr) {
@@ -1628,7 +1630,7 @@ public:
         data[i] = value;
       }
     }
-    return Literal(std::make_shared<GCData>(curr->type.getHeapType(), data),
+    return Literal(makeGCData(curr->type.getHeapType(), std::move(data)),
                    curr->type.getHeapType());
   }
   Flow visitArrayNewSeg(ArrayNewSeg* curr) { WASM_UNREACHABLE("unimp"); }
@@ -1659,7 +1661,7 @@ public:
       }
       data[i] = truncateForPacking(value.getSingleValue(), field);
     }
-    return Literal(std::make_shared<GCData>(curr->type.getHeapType(), data),
+    return Literal(makeGCData(curr->type.getHeapType(), std::move(data)),
                    curr->type.getHeapType());
   }
   Flow visitArrayGet(ArrayGet* curr) {
@@ -1775,7 +1777,7 @@ public:
   }
   Flow visitRefAs(RefAs* curr) {
     NOTE_ENTER("RefAs");
-    Flow flow = visit(curr->value);
+    Flow flow = self()->visit(curr->value);
     if (flow.breaking()) {
       return flow;
     }
@@ -1935,7 +1937,7 @@ public:
       // If we are evaluating and not replacing the expression, remember the
       // constant value set, if any, and see if there is a value flowing through
       // a tee.
-      auto setFlow = ExpressionRunner<SubType>::visit(curr->value);
+      auto setFlow = this->self()->visit(curr->value);
       if (!setFlow.breaking()) {
         setLocalValue(curr->index, setFlow.values);
         if (curr->type.isConcrete()) {
@@ -1954,7 +1956,7 @@ public:
       auto* global = this->module->getGlobal(curr->name);
       // Check if the global has an immutable value anyway
       if (!global->imported() && !global->mutable_) {
-        return ExpressionRunner<SubType>::visit(global->init);
+        return this->self()->visit(global->init);
       }
     }
     // Check if a constant value has been set in the context of this runner.
@@ -1972,7 +1974,7 @@ public:
       // If we are evaluating and not replacing the expression, remember the
       // constant value set, if any, for subsequent gets.
       assert(this->module->getGlobal(curr->name)->mutable_);
-      auto setFlow = ExpressionRunner<SubType>::visit(curr->value);
+      auto setFlow = this->self()->visit(curr->value);
       if (!setFlow.breaking()) {
         setGlobalValue(curr->name, setFlow.values);
         return Flow();
@@ -1996,13 +1998,13 @@ public:
           auto prevLocalValues = localValues;
           localValues.clear();
           for (Index i = 0; i < numOperands; ++i) {
-            auto argFlow = ExpressionRunner<SubType>::visit(curr->operands[i]);
+            auto argFlow = this->self()->visit(curr->operands[i]);
             if (!argFlow.breaking()) {
               assert(argFlow.values.isConcrete());
               localValues[i] = argFlow.values;
             }
           }
-          auto retFlow = ExpressionRunner<SubType>::visit(func->body);
+          auto retFlow = this->self()->visit(func->body);
           localValues = prevLocalValues;
           if (retFlow.breakTo == RETURN_FLOW) {
             return Flow(retFlow.values);
@@ -2162,6 +2164,125 @@ public:
   }
 };
 
+//
+// A function lowered into a compact register-based bytecode, which
+// ModuleRunnerBase can execute much faster than it can walk the expression
+// tree. Values are kept in 64-bit slots, with the function's locals first,
+// followed by temporaries, and branch targets are resolved to instruction
+// indexes ahead of time.
+//
+// Only functions whose locals, params and results are numeric, and that do not
+// use exception handling, are lowered; the interpreter handles the rest as
+// usual. Operations that have no opcode of their own are performed by visiting
+// a copy of the expression whose children are Consts that we set to the values
+// of their slots, so they behave exactly as in the interpreter.
+//
+struct PrecompiledFunction {
+  enum class Op : uint32_t {
+    Const,
+    Copy,
+    Jump,
+    JumpIf,
+    JumpIfNot,
+    Switch,
+    Select,
+    Return,
+    ReturnNone,
+    Unreachable,
+    GlobalGet,
+    GlobalSet,
+    Call,
+    Load,
+    Store,
+    Visit,
+    EqZInt32,
+    AddInt32,
+    SubInt32,
+    MulInt32,
+    AndInt32,
+    OrInt32,
+    XorInt32,
+    ShlInt32,
+    ShrSInt32,
+    ShrUInt32,
+    EqInt32,
+    NeInt32,
+    LtSInt32,
+    LtUInt32,
+    LeSInt32,
+    LeUInt32,
+    GtSInt32,
+    GtUInt32,
+    GeSInt32,
+    GeUInt32,
+    EqZInt64,
+    AddInt64,
+    SubInt64,
+    MulInt64,
+    AndInt64,
+    OrInt64,
+    XorInt64,
+    ShlInt64,
+    ShrSInt64,
+    ShrUInt64,
+    EqInt64,
+    NeInt64,
+    LtSInt64,
+    LtUInt64,
+    LeSInt64,
+    LeUInt64,
+    GtSInt64,
+    GtUInt64,
+    GeSInt64,
+    GeUInt64,
+    WrapInt64,
+    ExtendSInt32,
+    ExtendUInt32,
+  };
+
+  struct Instruction {
+    Op op;
+    // The slot the result is written to.
+    Index dst = 0;
+    // The slots of the operands. Calls and visits read their operands from
+    // consecutive slots starting at |a|.
+    Index a = 0;
+    Index b = 0;
+    // A constant, a jump target, the slot of a select's condition, the index
+    // of a jump table or of the operands of a visit, or whether a call is a
+    // return call.
+    uint64_t imm = 0;
+    // The expression we were lowered from, when we need it at runtime, or for
+    // a visit, the copy of it to visit.
+    Expression* expr = nullptr;
+    // The target of a call.
+    Function* func = nullptr;
+  };
+
+  std::vector<Instruction> code;
+
+  // The jump tables of Switch instructions. The last target is the default.
+  std::vector<std::vector<Index>> tables;
+
+  // The Consts that are the children of the copies we visit, in order of
+  // execution.
+  std::vector<std::vector<Const*>> visitOperands;
+
+  Index numSlots = 0;
+
+  // The body we were lowered from, so that we notice if it is replaced.
+  Expression* body = nullptr;
+
+  // Whether we could lower the function.
+  bool valid = false;
+
+  static std::unique_ptr<PrecompiledFunction> compile(Function* func,
+                                                      Module& wasm);
+
+  static uint64_t toBits(const Literal& value);
+  static Literal fromBits(uint64_t bits, Type type);
+};
+
 using GlobalValueSet = std::map<Name, Literals>;
 
 //
@@ -3469,7 +3590,7 @@ public:
       default:
         WASM_UNREACHABLE("unexpected op");
     }
-    return Literal(std::make_shared<GCData>(heapType, contents), heapType);
+    return Literal(makeGCData(heapType, std::move(contents)), heapType);
   }
   Flow visitTry(Try* curr) {
     NOTE_ENTER("Try");
@@ -3590,6 +3711,7 @@ public:
     // for us to clean up here
     callDepth = 0;
     functionStack.clear();
+    precompiledStack.clear();
     return callFunctionInternal(name, arguments);
   }
 
@@ -3606,6 +3728,29 @@ public:
 
     Function* function = wasm.getFunction(name);
     assert(function);
+    auto* precompiled = getPrecompiled(function);
+    if (precompiled && arguments.size() == function->getNumParams()) {
+      auto base = precompiledStack.size();
+      // Pop our slots however we leave, as an exception thrown from a callee
+      // may be caught by a caller in this same invocation.
+      struct StackScope {
+        std::vector<uint64_t>& stack;
+        size_t base;
+        ~StackScope() { stack.resize(base); }
+      } stackScope{precompiledStack, base};
+      precompiledStack.resize(base + precompiled->numSlots);
+      for (Index i = 0; i < arguments.size(); i++) {
+        precompiledStack[base + i] = PrecompiledFunction::toBits(arguments[i]);
+      }
+      auto result = runPrecompiled(*precompiled, base);
+      callDepth = previousCallDepth;
+      functionStack.resize(previousFunctionStackSize);
+      auto type = function->getResults();
+      if (type == Type::none) {
+        return {};
+      }
+      return {PrecompiledFunction::fromBits(result, type)};
+    }
     FunctionScope scope(function, arguments, *self());
 
 #ifdef WASM_INTERPRETER_DEBUG
@@ -3642,6 +3787,319 @@ public:
   // The maximum call stack depth to evaluate into.
   static const Index maxDepth = 250;
 
+  // Lowers functions to bytecode the first time they are called, and executes
+  // that, which is much faster than walking the expression tree (see
+  // PrecompiledFunction). Local, call, load and store operations, and those on
+  // defined globals, do not go through the visit methods, so subtypes that
+  // customize those should not enable this.
+  void setPrecompile(bool precompile_) { precompile = precompile_; }
+
+private:
+  bool precompile = false;
+
+  std::unordered_map<Function*, std::unique_ptr<PrecompiledFunction>>
+    precompiledFunctions;
+
+  // The slots of the precompiled functions that are executing.
+  std::vector<uint64_t> precompiledStack;
+
+  // Returns the precompiled version of a function, if we should run that.
+  PrecompiledFunction* getPrecompiled(Function* func) {
+    if (!precompile || func->imported()) {
+      return nullptr;
+    }
+    auto& precompiled = precompiledFunctions[func];
+    if (!precompiled || precompiled->body != func->body) {
+      precompiled = PrecompiledFunction::compile(func, wasm);
+    }
+    return precompiled->valid ? precompiled.get() : nullptr;
+  }
+
+  // Runs a precompiled function whose slots start at |base| in the stack, with
+  // the params in place and the rest zero, and returns the bits of the result.
+  uint64_t runPrecompiled(PrecompiledFunction& func, size_t base) {
+    using Op = PrecompiledFunction::Op;
+    // The stack may be reallocated when we call, after which we must update
+    // this.
+    auto* s = precompiledStack.data() + base;
+    Index pc = 0;
+    while (1) {
+      auto& instr = func.code[pc++];
+      auto dst = instr.dst;
+      auto a = instr.a;
+      auto b = instr.b;
+      switch (instr.op) {
+        case Op::Const:
+          s[dst] = instr.imm;
+          break;
+        case Op::Copy:
+          s[dst] = s[a];
+          break;
+        case Op::Jump:
+          pc = instr.imm;
+          break;
+        case Op::JumpIf:
+          if (uint32_t(s[a])) {
+            pc = instr.imm;
+          }
+          break;
+        case Op::JumpIfNot:
+          if (!uint32_t(s[a])) {
+            pc = instr.imm;
+          }
+          break;
+        case Op::Switch: {
+          auto& table = func.tables[instr.imm];
+          pc = table[std::min(size_t(uint32_t(s[a])), table.size() - 1)];
+          break;
+        }
+        case Op::Select:
+          s[dst] = uint32_t(s[instr.imm]) ? s[a] : s[b];
+          break;
+        case Op::Return:
+          return s[a];
+        case Op::ReturnNone:
+          return 0;
+        case Op::Unreachable:
+          trap("unreachable");
+          WASM_UNREACHABLE("unreachable");
+        case Op::GlobalGet:
+          s[dst] = PrecompiledFunction::toBits(
+            getGlobal(instr.expr->template cast<GlobalGet>()->name)[0]);
+          break;
+        case Op::GlobalSet: {
+          auto* set = instr.expr->template cast<GlobalSet>();
+          getGlobal(set->name) =
+            Literals{PrecompiledFunction::fromBits(s[a], set->value->type)};
+          break;
+        }
+        case Op::Call: {
+          auto* target = instr.func;
+          if (auto* callee = getPrecompiled(target)) {
+            if (callDepth > maxDepth) {
+              externalInterface->trap("stack limit");
+            }
+            auto previousCallDepth = callDepth;
+            callDepth++;
+            auto previousFunctionStackSize = functionStack.size();
+            functionStack.push_back(target->name);
+            auto calleeBase = precompiledStack.size();
+            precompiledStack.resize(calleeBase + callee->numSlots);
+            std::copy_n(precompiledStack.begin() + base + a,
+                        target->getNumParams(),
+                        precompiledStack.begin() + calleeBase);
+            auto result = runPrecompiled(*callee, calleeBase);
+            precompiledStack.resize(calleeBase);
+            callDepth = previousCallDepth;
+            functionStack.resize(previousFunctionStackSize);
+            s = precompiledStack.data() + base;
+            s[dst] = result;
+          } else {
+            Literals arguments;
+            Index i = 0;
+            for (auto param : target->getParams()) {
+              arguments.push_back(
+                PrecompiledFunction::fromBits(s[a + i++], param));
+            }
+            auto results =
+              target->imported()
+                ? externalInterface->callImport(target, arguments)
+                : callFunctionInternal(target->name, arguments);
+            s = precompiledStack.data() + base;
+            if (!results.empty()) {
+              s[dst] = PrecompiledFunction::toBits(results[0]);
+            }
+          }
+          if (instr.imm) {
+            return s[dst];
+          }
+          break;
+        }
+        case Op::Load: {
+          auto* load = instr.expr->template cast<Load>();
+          auto info = getMemoryInstanceInfo(load->memory);
+          auto memorySize = info.instance->getMemorySize(info.name);
+          auto addr = info.instance->getFinalAddress(
+            load,
+            PrecompiledFunction::fromBits(s[a], load->ptr->type),
+            memorySize);
+          if (load->isAtomic) {
+            info.instance->checkAtomicAddress(addr, load->bytes, memorySize);
+          }
+          s[dst] = PrecompiledFunction::toBits(
+            info.instance->externalInterface->load(load, addr, info.name));
+          break;
+        }
+        case Op::Store: {
+          auto* store = instr.expr->template cast<Store>();
+          auto info = getMemoryInstanceInfo(store->memory);
+          auto memorySize = info.instance->getMemorySize(info.name);
+          auto addr = info.instance->getFinalAddress(
+            store,
+            PrecompiledFunction::fromBits(s[a], store->ptr->type),
+            memorySize);
+          if (store->isAtomic) {
+            info.instance->checkAtomicAddress(addr, store->bytes, memorySize);
+          }
+          info.instance->externalInterface->store(
+            store,
+            addr,
+            PrecompiledFunction::fromBits(s[b], store->valueType),
+            info.name);
+          break;
+        }
+        case Op::Visit: {
+          auto& operands = func.visitOperands[instr.imm];
+          for (Index i = 0; i < operands.size(); i++) {
+            operands[i]->value =
+              PrecompiledFunction::fromBits(s[a + i], operands[i]->type);
+          }
+          auto flow = self()->visit(instr.expr);
+          s = precompiledStack.data() + base;
+          if (flow.breaking()) {
+            // Only a return call can get here.
+            return flow.values.empty()
+                     ? 0
+                     : PrecompiledFunction::toBits(flow.getSingleValue());
+          }
+          if (!flow.values.empty()) {
+            s[dst] = PrecompiledFunction::toBits(flow.getSingleValue());
+          }
+          break;
+        }
+        case Op::EqZInt32:
+          s[dst] = uint32_t(s[a]) == 0;
+          break;
+        case Op::AddInt32:
+          s[dst] = uint32_t(s[a] + s[b]);
+          break;
+        case Op::SubInt32:
+          s[dst] = uint32_t(s[a] - s[b]);
+          break;
+        case Op::MulInt32:
+          s[dst] = uint32_t(s[a] * s[b]);
+          break;
+        case Op::AndInt32:
+          s[dst] = uint32_t(s[a] & s[b]);
+          break;
+        case Op::OrInt32:
+          s[dst] = uint32_t(s[a] | s[b]);
+          break;
+        case Op::XorInt32:
+          s[dst] = uint32_t(s[a] ^ s[b]);
+          break;
+        case Op::ShlInt32:
+          s[dst] = uint32_t(uint32_t(s[a]) << (s[b] & 31));
+          break;
+        case Op::ShrSInt32:
+          s[dst] = uint32_t(int32_t(s[a]) >> (s[b] & 31));
+          break;
+        case Op::ShrUInt32:
+          s[dst] = uint32_t(s[a]) >> (s[b] & 31);
+          break;
+        case Op::EqInt32:
+          s[dst] = uint32_t(s[a]) == uint32_t(s[b]);
+          break;
+        case Op::NeInt32:
+          s[dst] = uint32_t(s[a]) != uint32_t(s[b]);
+          break;
+        case Op::LtSInt32:
+          s[dst] = int32_t(s[a]) < int32_t(s[b]);
+          break;
+        case Op::LtUInt32:
+          s[dst] = uint32_t(s[a]) < uint32_t(s[b]);
+          break;
+        case Op::LeSInt32:
+          s[dst] = int32_t(s[a]) <= int32_t(s[b]);
+          break;
+        case Op::LeUInt32:
+          s[dst] = uint32_t(s[a]) <= uint32_t(s[b]);
+          break;
+        case Op::GtSInt32:
+          s[dst] = int32_t(s[a]) > int32_t(s[b]);
+          break;
+        case Op::GtUInt32:
+          s[dst] = uint32_t(s[a]) > uint32_t(s[b]);
+          break;
+        case Op::GeSInt32:
+          s[dst] = int32_t(s[a]) >= int32_t(s[b]);
+          break;
+        case Op::GeUInt32:
+          s[dst] = uint32_t(s[a]) >= uint32_t(s[b]);
+          break;
+        case Op::EqZInt64:
+          s[dst] = s[a] == 0;
+          break;
+        case Op::AddInt64:
+          s[dst] = s[a] + s[b];
+          break;
+        case Op::SubInt64:
+          s[dst] = s[a] - s[b];
+          break;
+        case Op::MulInt64:
+          s[dst] = s[a] * s[b];
+          break;
+        case Op::AndInt64:
+          s[dst] = s[a] & s[b];
+          break;
+        case Op::OrInt64:
+          s[dst] = s[a] | s[b];
+          break;
+        case Op::XorInt64:
+          s[dst] = s[a] ^ s[b];
+          break;
+        case Op::ShlInt64:
+          s[dst] = s[a] << (s[b] & 63);
+          break;
+        case Op::ShrSInt64:
+          s[dst] = int64_t(s[a]) >> (s[b] & 63);
+          break;
+        case Op::ShrUInt64:
+          s[dst] = s[a] >> (s[b] & 63);
+          break;
+        case Op::EqInt64:
+          s[dst] = s[a] == s[b];
+          break;
+        case Op::NeInt64:
+          s[dst] = s[a] != s[b];
+          break;
+        case Op::LtSInt64:
+          s[dst] = int64_t(s[a]) < int64_t(s[b]);
+          break;
+        case Op::LtUInt64:
+          s[dst] = s[a] < s[b];
+          break;
+        case Op::LeSInt64:
+          s[dst] = int64_t(s[a]) <= int64_t(s[b]);
+          break;
+        case Op::LeUInt64:
+          s[dst] = s[a] <= s[b];
+          break;
+        case Op::GtSInt64:
+          s[dst] = int64_t(s[a]) > int64_t(s[b]);
+          break;
+        case Op::GtUInt64:
+          s[dst] = s[a] > s[b];
+          break;
+        case Op::GeSInt64:
+          s[dst] = int64_t(s[a]) >= int64_t(s[b]);
+          break;
+        case Op::GeUInt64:
+          s[dst] = s[a] >= s[b];
+          break;
+        case Op::WrapInt64:
+          s[dst] = uint32_t(s[a]);
+          break;
+        case Op::ExtendSInt32:
+          s[dst] = int64_t(int32_t(s[a]));
+          break;
+        case Op::ExtendUInt32:
+          s[dst] = uint32_t(s[a]);
+          break;
+      }
+    }
+  }
+
 protected:
   void trapIfGt(uint64_t lhs, uint64_t rhs, const char* msg) {
     if (lhs > rhs) {
@@ -57,6 +57,12 @@ public:
     skipFunctionBodies = skipFunctionBodies_;
   }
 
+  // Decode function bodies in binaries only when they are first needed. See
+  // WasmBinaryBuilder::setLazyFunctionBodies.
+  void setLazyFunctionBodies(bool lazyFunctionBodies_) {
+    lazyFunctionBodies = lazyFunctionBodies_;
+  }
+
   // read text
   void readText(std::string filename, Module& wasm);
   // read binary
@@ -77,9 +83,11 @@ private:
 
   bool skipFunctionBodies = false;
 
+  bool lazyFunctionBodies = false;
+
   void readStdin(Module& wasm, std::string sourceMapFilename);
 
-  void readBinaryData(std::vector<char>& input,
+  void readBinaryData(std::string_view input,
                       Module& wasm,
                       std::string sourceMapFilename);
 };
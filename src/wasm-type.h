@@ -51,6 +51,11 @@ void setTypeSystem(TypeSystem system);
 
 TypeSystem getTypeSystem();
 
+// The number of times a thread has had to wait for access to the global type
+// stores so far. Useful for measuring contention when creating types from many
+// threads.
+size_t getTypeStoreContention();
+
 // Dangerous! Frees all types and heap types that have ever been created and
 // resets the type system's internal state. This is only really meant to be used
 // for tests.
@@ -26,6 +26,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <map>
 #include <ostream>
@@ -1931,6 +1932,14 @@ class StackInst;
 
 using StackIR = std::vector<StackInst*>;
 
+// A function body that has not been decoded from its binary yet. See
+// WasmBinaryBuilder::setLazyFunctionBodies.
+struct LazyFunctionBody {
+  virtual ~LazyFunctionBody() = default;
+  // Decode the body into the function.
+  virtual void materialize(Function* func) = 0;
+};
+
 class Function : public Importable {
 public:
   HeapType type = HeapType(Signature()); // parameters and return value
@@ -2009,6 +2018,27 @@ public:
 
   void clearNames();
   void clearDebugInfo();
+
+  // A lazy function's body has not been decoded yet, and `body` is null. Call
+  // `materialize` before using the body. The pass runner, the validator and the
+  // binary writer do this automatically.
+  bool isLazy() const { return lazy.load(std::memory_order_acquire); }
+  void setLazyBody(std::unique_ptr<LazyFunctionBody> body);
+  // Decode the body if it has not been decoded yet. This may be called from
+  // multiple threads, and is cheap if the function is not lazy.
+  void materialize() {
+    if (isLazy()) {
+      materializeLazy();
+    }
+  }
+
+private:
+  std::unique_ptr<LazyFunctionBody> lazyBody;
+  // Whether we have a lazy body. This can be checked without a lock, and is
+  // cleared once the body is decoded.
+  std::atomic<bool> lazy{false};
+
+  void materializeLazy();
 };
 
 // The kind of an import or export.
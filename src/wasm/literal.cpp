@@ -52,7 +52,7 @@ Literal::Literal(Type type) : type(type) {
 
   if (type.isNull()) {
     assert(type.isNullable());
-    new (&gcData) std::shared_ptr<GCData>();
+    new (&gcData) GCDataRef();
     return;
   }
 
@@ -69,10 +69,10 @@ Literal::Literal(const uint8_t init[16]) : type(Type::v128) {
   memcpy(&v128, init, 16);
 }
 
-Literal::Literal(std::shared_ptr<GCData> gcData, HeapType type)
-  : gcData(gcData), type(type, NonNullable) {
+Literal::Literal(GCDataRef gcData, HeapType type)
+  : gcData(std::move(gcData)), type(type, NonNullable) {
   // The type must be a proper type for GC data.
-  assert((isData() && gcData) || (type.isBottom() && !gcData));
+  assert((isData() && this->gcData) || (type.isBottom() && !this->gcData));
 }
 
 Literal::Literal(const Literal& other) : type(other.type) {
@@ -96,11 +96,11 @@ Literal::Literal(const Literal& other) : type(other.type) {
     }
   }
   if (other.isNull()) {
-    new (&gcData) std::shared_ptr<GCData>();
+    new (&gcData) GCDataRef();
     return;
   }
   if (other.isData()) {
-    new (&gcData) std::shared_ptr<GCData>(other.gcData);
+    new (&gcData) GCDataRef(other.gcData);
     return;
   }
   if (type.isFunction()) {
@@ -138,13 +138,22 @@ Literal::Literal(const Literal& other) : type(other.type) {
   }
 }
 
+Literal::Literal(Literal&& other) noexcept : type(other.type) {
+  if (!type.isBasic() && (other.isNull() || other.isData())) {
+    new (&gcData) GCDataRef(std::move(other.gcData));
+    return;
+  }
+  // Nothing else owns anything, so we can just copy the bits.
+  memcpy(&v128, other.v128, 16);
+}
+
 Literal::~Literal() {
   // Early exit for the common case; basic types need no special handling.
   if (type.isBasic()) {
     return;
   }
   if (isNull() || isData()) {
-    gcData.~shared_ptr();
+    gcData.~GCDataRef();
   }
 }
 
@@ -156,6 +165,14 @@ Literal& Literal::operator=(const Literal& other) {
   return *this;
 }
 
+Literal& Literal::operator=(Literal&& other) noexcept {
+  if (this != &other) {
+    this->~Literal();
+    new (this) Literal(std::move(other));
+  }
+  return *this;
+}
+
 template<typename LaneT, int Lanes>
 static void extractBytes(uint8_t (&dest)[16], const LaneArray<Lanes>& lanes) {
   std::array<uint8_t, 16> bytes;
@@ -307,7 +324,7 @@ std::array<uint8_t, 16> Literal::getv128() const {
   return ret;
 }
 
-std::shared_ptr<GCData> Literal::getGCData() const {
+const GCDataRef& Literal::getGCData() const {
   assert(isNull() || isData());
   return gcData;
 }
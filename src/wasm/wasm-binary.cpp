@@ -15,6 +15,8 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <exception>
 #include <fstream>
 
 #include "ir/eh-utils.h"
@@ -23,6 +25,7 @@
 #include "ir/type-updating.h"
 #include "support/bits.h"
 #include "support/debug.h"
+#include "support/threads.h"
 #include "wasm-binary.h"
 #include "wasm-debug.h"
 #include "wasm-stack.h"
@@ -32,9 +35,11 @@
 namespace wasm {
 
 void WasmBinaryWriter::prepare() {
+  // We need to see all the code to compute the indexes of types.
+  ModuleUtils::materializeFunctions(*wasm);
   // Collect function types and their frequencies. Collect information in each
   // function in parallel, then merge.
-  indexedTypes = ModuleUtils::getOptimizedIndexedHeapTypes(*wasm);
+  tables->indexedTypes = ModuleUtils::getOptimizedIndexedHeapTypes(*wasm);
   importInfo = wasm::make_unique<ImportInfo>(*wasm);
 }
 
@@ -88,6 +93,7 @@ void WasmBinaryWriter::write() {
 
   writeLateCustomSections();
   writeFeaturesSection();
+  flush();
 }
 
 void WasmBinaryWriter::writeHeader() {
@@ -123,6 +129,7 @@ void WasmBinaryWriter::writeResizableLimits(
 }
 
 template<typename T> int32_t WasmBinaryWriter::startSection(T code) {
+  sectionDepth++;
   o << uint8_t(code);
   if (sourceMap) {
     sourceMapLocationsSizeAtSectionStart = sourceMapLocations.size();
@@ -184,6 +191,22 @@ void WasmBinaryWriter::finishSection(int32_t start) {
       }
     }
   }
+
+  assert(sectionDepth > 0);
+  if (--sectionDepth == 0) {
+    flush();
+  }
+}
+
+void WasmBinaryWriter::flush() {
+  // Everything before the current section is final, so we can hand it off.
+  assert(sectionDepth == 0);
+  if (!streamingOutput || o.empty()) {
+    return;
+  }
+  streamingOutput(o.data(), o.size());
+  flushedBytes += o.size();
+  o.clear();
 }
 
 int32_t WasmBinaryWriter::startSubsection(
@@ -380,32 +403,23 @@ void WasmBinaryWriter::writeFunctions() {
     return;
   }
   BYN_TRACE("== writeFunctions\n");
+  bool DWARF = Debug::hasDWARFSections(*getModule());
+  // DWARF tracks the locations of expressions relative to the code section as
+  // we write, so it is only supported when writing serially.
+  if (!DWARF && importInfo->getNumDefinedFunctions() > 1 &&
+      ThreadPool::get()->size() > 1) {
+    writeFunctionsInParallel();
+    return;
+  }
   auto sectionStart = startSection(BinaryConsts::Section::Code);
   o << U32LEB(importInfo->getNumDefinedFunctions());
-  bool DWARF = Debug::hasDWARFSections(*getModule());
   ModuleUtils::iterDefinedFunctions(*wasm, [&](Function* func) {
     assert(binaryLocationTrackedExpressionsForFunc.empty());
     size_t sourceMapLocationsSizeAtFunctionStart = sourceMapLocations.size();
     BYN_TRACE("write one at" << o.size() << std::endl);
     size_t sizePos = writeU32LEBPlaceholder();
     size_t start = o.size();
-    BYN_TRACE("writing" << func->name << std::endl);
-    // Emit Stack IR if present, and if we can
-    if (func->stackIR && !sourceMap && !DWARF) {
-      BYN_TRACE("write Stack IR\n");
-      StackIRToBinaryWriter writer(*this, o, func);
-      writer.write();
-      if (debugInfo) {
-        funcMappedLocals[func->name] = std::move(writer.getMappedLocals());
-      }
-    } else {
-      BYN_TRACE("write Binaryen IR\n");
-      BinaryenIRToBinaryWriter writer(*this, o, func, sourceMap, DWARF);
-      writer.write();
-      if (debugInfo) {
-        funcMappedLocals[func->name] = std::move(writer.getMappedLocals());
-      }
-    }
+    writeFunctionBody(func, DWARF);
     size_t size = o.size() - start;
     assert(size <= std::numeric_limits<uint32_t>::max());
     BYN_TRACE("body size: " << size << ", writing at " << sizePos
@@ -448,7 +462,7 @@ void WasmBinaryWriter::writeFunctions() {
         BinaryLocation(o.size())};
     }
     tableOfContents.functionBodies.emplace_back(
-      func->name, sizePos + sizeFieldSize, size);
+      func->name, flushedBytes + sizePos + sizeFieldSize, size);
     binaryLocationTrackedExpressionsForFunc.clear();
 
     if (func->getParams().size() > WebLimitations::MaxFunctionParams) {
@@ -459,6 +473,112 @@ void WasmBinaryWriter::writeFunctions() {
   finishSection(sectionStart);
 }
 
+void WasmBinaryWriter::writeFunctionsInParallel() {
+  auto sectionStart = startSection(BinaryConsts::Section::Code);
+  o << U32LEB(importInfo->getNumDefinedFunctions());
+
+  // Each thread writes bodies with a writer of its own, appending them to its
+  // own buffer. We note where each body ended up, and then copy them into the
+  // output in order, at which point we know the size of each one and do not
+  // need to shrink any LEBs.
+  struct Task {
+    Function* func;
+    size_t thread;
+    // The range of the body in the thread's buffer.
+    size_t start;
+    size_t end;
+    // The range of the body's locations in the thread's source map locations.
+    size_t sourceMapStart;
+    size_t sourceMapEnd;
+  };
+  std::vector<Task> tasks;
+  ModuleUtils::iterDefinedFunctions(
+    *wasm, [&](Function* func) { tasks.push_back(Task{func}); });
+
+  size_t num = ThreadPool::get()->size();
+  std::vector<BufferWithRandomAccess> buffers(num);
+  std::vector<std::unique_ptr<WasmBinaryWriter>> writers;
+  for (size_t i = 0; i < num; i++) {
+    writers.emplace_back(new WasmBinaryWriter(*this, buffers[i]));
+  }
+  std::atomic<size_t> nextFunction(0);
+  std::vector<std::function<ThreadWorkState()>> doWorkers;
+  for (size_t i = 0; i < num; i++) {
+    doWorkers.push_back([&, i]() {
+      auto index = nextFunction.fetch_add(1);
+      if (index >= tasks.size()) {
+        return ThreadWorkState::Finished;
+      }
+      auto& task = tasks[index];
+      auto& writer = *writers[i];
+      task.thread = i;
+      task.start = buffers[i].size();
+      task.sourceMapStart = writer.sourceMapLocations.size();
+      // Each body notes its first location even if it matches the end of the
+      // previous one; we remove duplicates when merging, as we do not know
+      // what the previous body in the output is here.
+      writer.lastDebugLocation = {BinaryLocation(-1),
+                                  BinaryLocation(-1),
+                                  BinaryLocation(-1)};
+      writer.writeFunctionBody(task.func, false);
+      task.end = buffers[i].size();
+      task.sourceMapEnd = writer.sourceMapLocations.size();
+      return ThreadWorkState::More;
+    });
+  }
+  ThreadPool::get()->work(doWorkers);
+
+  for (auto& task : tasks) {
+    auto* func = task.func;
+    auto& buffer = buffers[task.thread];
+    auto& writer = *writers[task.thread];
+    size_t size = task.end - task.start;
+    assert(size <= std::numeric_limits<uint32_t>::max());
+    o << U32LEB(size);
+    size_t start = flushedBytes + o.size();
+    o.insert(o.end(), buffer.begin() + task.start, buffer.begin() + task.end);
+    for (auto i = task.sourceMapStart; i < task.sourceMapEnd; ++i) {
+      auto [offset, loc] = writer.sourceMapLocations[i];
+      if (*loc == lastDebugLocation) {
+        continue;
+      }
+      sourceMapLocations.emplace_back(offset - task.start + start, loc);
+      lastDebugLocation = *loc;
+    }
+    if (debugInfo) {
+      funcMappedLocals[func->name] =
+        std::move(writer.funcMappedLocals[func->name]);
+    }
+    tableOfContents.functionBodies.emplace_back(func->name, start, size);
+
+    if (func->getParams().size() > WebLimitations::MaxFunctionParams) {
+      std::cerr << "Some VMs may not accept this binary because it has a large "
+                << "number of parameters in function " << func->name << ".\n";
+    }
+  }
+  finishSection(sectionStart);
+}
+
+void WasmBinaryWriter::writeFunctionBody(Function* func, bool DWARF) {
+  BYN_TRACE("writing" << func->name << std::endl);
+  // Emit Stack IR if present, and if we can
+  if (func->stackIR && !sourceMap && !DWARF) {
+    BYN_TRACE("write Stack IR\n");
+    StackIRToBinaryWriter writer(*this, o, func);
+    writer.write();
+    if (debugInfo) {
+      funcMappedLocals[func->name] = std::move(writer.getMappedLocals());
+    }
+  } else {
+    BYN_TRACE("write Binaryen IR\n");
+    BinaryenIRToBinaryWriter writer(*this, o, func, sourceMap, DWARF);
+    writer.write();
+    if (debugInfo) {
+      funcMappedLocals[func->name] = std::move(writer.getMappedLocals());
+    }
+  }
+}
+
 void WasmBinaryWriter::writeStrings() {
   assert(wasm->features.hasStrings());
 
@@ -500,7 +620,7 @@ void WasmBinaryWriter::writeStrings() {
   }
   std::sort(sorted.begin(), sorted.end());
   for (Index i = 0; i < sorted.size(); i++) {
-    stringIndexes[sorted[i]] = i;
+    tables->stringIndexes[sorted[i]] = i;
   }
 
   auto num = sorted.size();
@@ -770,7 +890,7 @@ void WasmBinaryWriter::writeElementSegments() {
     o << U32LEB(0); // type (indicating funcref)
     o << U32LEB(needingElemDecl.size());
     for (auto name : needingElemDecl) {
-      o << U32LEB(indexes.functionIndexes[name]);
+      o << U32LEB(getFunctionIndex(name));
     }
   }
 
@@ -906,7 +1026,7 @@ void WasmBinaryWriter::writeNames() {
         startSubsection(BinaryConsts::CustomSections::Subsection::NameType);
       o << U32LEB(namedTypes.size());
       for (auto type : namedTypes) {
-        o << U32LEB(indexedTypes.indices[type]);
+        o << U32LEB(getTypeIndex(type));
         writeEscapedName(wasm->typeNames[type].name.str);
       }
       finishSubsection(substart);
@@ -1059,7 +1179,7 @@ void WasmBinaryWriter::writeNames() {
       o << U32LEB(relevantTypes.size());
       for (Index i = 0; i < relevantTypes.size(); i++) {
         auto type = relevantTypes[i];
-        o << U32LEB(indexedTypes.indices[type]);
+        o << U32LEB(getTypeIndex(type));
         std::unordered_map<Index, Name>& fieldNames =
           wasm->typeNames.at(type).fieldNames;
         o << U32LEB(fieldNames.size());
@@ -1304,7 +1424,7 @@ void WasmBinaryWriter::writeDebugLocation(const Function::DebugLocation& loc) {
   if (loc == lastDebugLocation) {
     return;
   }
-  auto offset = o.size();
+  auto offset = flushedBytes + o.size();
   sourceMapLocations.emplace_back(offset, &loc);
   lastDebugLocation = loc;
 }
@@ -1571,7 +1691,7 @@ void WasmBinaryWriter::writeField(const Field& field) {
 
 WasmBinaryBuilder::WasmBinaryBuilder(Module& wasm,
                                      FeatureSet features,
-                                     const std::vector<char>& input)
+                                     std::string_view input)
   : wasm(wasm), allocator(wasm.allocator), input(input), sourceMap(nullptr),
     nextDebugLocation(0, {0, 0, 0}), debugLocation() {
   wasm.features = features;
@@ -1705,6 +1825,10 @@ void WasmBinaryBuilder::read() {
 
   validateBinary();
   processNames();
+
+  if (!lazyFunctions.empty()) {
+    setUpLazyFunctions();
+  }
 }
 
 void WasmBinaryBuilder::readCustomSection(size_t payloadLen) {
@@ -2498,6 +2622,15 @@ void WasmBinaryBuilder::readFunctions() {
   if (total != functionTypes.size() - numImports) {
     throwError("invalid function section size, must equal types");
   }
+  // Debug info must be read in order, as it refers to positions in the binary
+  // through a stream or through the binary locations of each expression.
+  bool lazy =
+    lazyFunctionBodies && !DWARF && !sourceMap && !skipFunctionBodies;
+  if (!lazy && !DWARF && !sourceMap && total > 1 &&
+      ThreadPool::get()->size() > 1) {
+    readFunctionsInParallel(total);
+    return;
+  }
   for (size_t i = 0; i < total; i++) {
     BYN_TRACE("read one at " << pos << std::endl);
     auto sizePos = pos;
@@ -2510,7 +2643,6 @@ void WasmBinaryBuilder::readFunctions() {
     auto* func = new Function;
     func->name = Name::fromInt(i);
     func->type = getTypeByFunctionIndex(numImports + i);
-    currFunction = func;
 
     if (DWARF) {
       func->funcLocation = BinaryLocations::FunctionLocations{
@@ -2519,69 +2651,275 @@ void WasmBinaryBuilder::readFunctions() {
         BinaryLocation(pos - codeSectionLocation + size)};
     }
 
-    readNextDebugLocation();
-
     BYN_TRACE("reading " << i << std::endl);
+    if (lazy) {
+      // Read the locals, which are part of the function's interface, but leave
+      // the code to be decoded when it is needed.
+      currFunction = func;
+      readVars();
+      currFunction = nullptr;
+      lazyFunctions.push_back({func, pos, endOfFunction});
+      pos = endOfFunction;
+    } else {
+      readFunctionBody(func, startIndex == numImports + i);
+    }
+    wasm.addFunction(func);
+  }
+  BYN_TRACE(" end function bodies\n");
+}
 
-    readVars();
-
-    std::swap(func->prologLocation, debugLocation);
-    {
-      // process the function body
-      BYN_TRACE("processing function: " << i << std::endl);
-      nextLabel = 0;
-      debugLocation.clear();
-      willBeIgnored = false;
-      // process body
-      assert(breakStack.empty());
-      assert(breakTargetNames.empty());
-      assert(exceptionTargetNames.empty());
-      assert(expressionStack.empty());
-      assert(controlFlowStack.empty());
-      assert(depth == 0);
-      // Even if we are skipping function bodies we need to not skip the start
-      // function. That contains important code for wasm-emscripten-finalize in
-      // the form of pthread-related segment initializations. As this is just
-      // one function, it doesn't add significant time, so the optimization of
-      // skipping bodies is still very useful.
-      auto currFunctionIndex = wasm.functions.size();
-      bool isStart = startIndex == currFunctionIndex;
-      if (!skipFunctionBodies || isStart) {
-        func->body = getBlockOrSingleton(func->getResults());
-      } else {
-        // When skipping the function body we need to put something valid in
-        // their place so we validate. An unreachable is always acceptable
-        // there.
-        func->body = Builder(wasm).makeUnreachable();
+void WasmBinaryBuilder::readFunctionsInParallel(size_t total) {
+  auto numImports = wasm.functions.size();
 
-        // Skip reading the contents.
-        pos = endOfFunction;
-      }
-      assert(depth == 0);
-      assert(breakStack.empty());
-      assert(breakTargetNames.empty());
-      assert(exceptionTargetNames.empty());
-      if (!expressionStack.empty()) {
-        throwError("stack not empty on function exit");
-      }
-      assert(controlFlowStack.empty());
-      if (pos != endOfFunction) {
-        throwError("binary offset at function exit not at expected location");
-      }
+  // The size of each function is given before its body, so we can find the
+  // range of every body without decoding any of them.
+  struct Task {
+    size_t start;
+    size_t end;
+    std::unique_ptr<Function> func;
+    std::exception_ptr error;
+  };
+  std::vector<Task> tasks(total);
+  for (size_t i = 0; i < total; i++) {
+    size_t size = getU32LEB();
+    if (size == 0) {
+      throwError("empty function size");
+    }
+    if (size > input.size() - pos) {
+      throwError("function extends beyond end of input");
     }
+    auto& task = tasks[i];
+    task.start = pos;
+    task.end = pos + size;
+    task.func = std::make_unique<Function>();
+    task.func->name = Name::fromInt(i);
+    task.func->type = getTypeByFunctionIndex(numImports + i);
+    pos += size;
+  }
+  auto endOfSection = pos;
 
-    if (!wasm.features.hasGCNNLocals()) {
-      TypeUpdating::handleNonDefaultableLocals(func, wasm);
+  // Each thread decodes bodies with a reader of its own. Anything it allocates
+  // goes to the module's arena for that thread.
+  size_t num = ThreadPool::get()->size();
+  std::vector<std::unique_ptr<WasmBinaryBuilder>> readers;
+  for (size_t i = 0; i < num; i++) {
+    readers.push_back(makeFunctionReader(input));
+  }
+  std::atomic<size_t> nextFunction(0);
+  std::vector<std::function<ThreadWorkState()>> doWorkers;
+  for (size_t i = 0; i < num; i++) {
+    doWorkers.push_back([&, i]() {
+      auto index = nextFunction.fetch_add(1);
+      if (index >= total) {
+        return ThreadWorkState::Finished;
+      }
+      auto& task = tasks[index];
+      auto& reader = *readers[i];
+      try {
+        reader.pos = task.start;
+        reader.endOfFunction = task.end;
+        reader.readFunctionBody(task.func.get(),
+                                startIndex == numImports + index);
+      } catch (...) {
+        // The reader may be in an inconsistent state now, so stop using it.
+        task.error = std::current_exception();
+        return ThreadWorkState::Finished;
+      }
+      return ThreadWorkState::More;
+    });
+  }
+  ThreadPool::get()->work(doWorkers);
+
+  // Report the error in the earliest function, if there were any.
+  for (auto& task : tasks) {
+    if (task.error) {
+      std::rethrow_exception(task.error);
     }
+  }
 
-    std::swap(func->epilogLocation, debugLocation);
-    currFunction = nullptr;
-    debugLocation.clear();
-    wasm.addFunction(func);
+  // Merge the references to module elements that the readers saw, so that we
+  // fix up their names later as usual, and add the functions in order.
+  auto merge = [](auto& into, auto& from) {
+    for (auto& [index, refs] : from) {
+      auto& mergedRefs = into[index];
+      mergedRefs.insert(mergedRefs.end(), refs.begin(), refs.end());
+    }
+  };
+  for (auto& reader : readers) {
+    merge(functionRefs, reader->functionRefs);
+    merge(tableRefs, reader->tableRefs);
+    merge(memoryRefs, reader->memoryRefs);
+    merge(globalRefs, reader->globalRefs);
+    merge(tagRefs, reader->tagRefs);
   }
+  for (auto& task : tasks) {
+    wasm.addFunction(std::move(task.func));
+  }
+  pos = endOfSection;
   BYN_TRACE(" end function bodies\n");
 }
 
+void WasmBinaryBuilder::readFunctionBody(Function* func, bool isStart) {
+  currFunction = func;
+
+  readNextDebugLocation();
+
+  readVars();
+
+  std::swap(func->prologLocation, debugLocation);
+  readFunctionCode(func, isStart);
+}
+
+void WasmBinaryBuilder::readFunctionCode(Function* func, bool isStart) {
+  currFunction = func;
+  {
+    // process the function body
+    BYN_TRACE("processing function: " << func->name << std::endl);
+    nextLabel = 0;
+    debugLocation.clear();
+    willBeIgnored = false;
+    // process body
+    assert(breakStack.empty());
+    assert(breakTargetNames.empty());
+    assert(exceptionTargetNames.empty());
+    assert(expressionStack.empty());
+    assert(controlFlowStack.empty());
+    assert(depth == 0);
+    // Even if we are skipping function bodies we need to not skip the start
+    // function. That contains important code for wasm-emscripten-finalize in
+    // the form of pthread-related segment initializations. As this is just
+    // one function, it doesn't add significant time, so the optimization of
+    // skipping bodies is still very useful.
+    if (!skipFunctionBodies || isStart) {
+      func->body = getBlockOrSingleton(func->getResults());
+    } else {
+      // When skipping the function body we need to put something valid in
+      // their place so we validate. An unreachable is always acceptable
+      // there.
+      func->body = Builder(wasm).makeUnreachable();
+
+      // Skip reading the contents.
+      pos = endOfFunction;
+    }
+    assert(depth == 0);
+    assert(breakStack.empty());
+    assert(breakTargetNames.empty());
+    assert(exceptionTargetNames.empty());
+    if (!expressionStack.empty()) {
+      throwError("stack not empty on function exit");
+    }
+    assert(controlFlowStack.empty());
+    if (pos != endOfFunction) {
+      throwError("binary offset at function exit not at expected location");
+    }
+  }
+
+  if (!wasm.features.hasGCNNLocals()) {
+    TypeUpdating::handleNonDefaultableLocals(func, wasm);
+  }
+
+  std::swap(func->epilogLocation, debugLocation);
+  currFunction = nullptr;
+  debugLocation.clear();
+}
+
+std::unique_ptr<WasmBinaryBuilder>
+WasmBinaryBuilder::makeFunctionReader(std::string_view code) {
+  auto reader = std::make_unique<WasmBinaryBuilder>(wasm, wasm.features, code);
+  reader->debugInfo = debugInfo;
+  reader->skipFunctionBodies = skipFunctionBodies;
+  reader->startIndex = startIndex;
+  reader->types = types;
+  reader->functionTypes = functionTypes;
+  reader->strings = strings;
+  reader->dataCount = dataCount;
+  reader->hasDataCount = hasDataCount;
+  return reader;
+}
+
+// Decodes the code of functions that were read lazily. This keeps a copy of the
+// code section and a reader for it, as well as the names of module elements by
+// their index in the binary, so that references in the code can be given their
+// names right away.
+struct LazyFunctionReader {
+  std::vector<char> code;
+  // Where the code begins in the original binary.
+  size_t offset;
+  std::unique_ptr<WasmBinaryBuilder> reader;
+
+  std::vector<Name> functionNames;
+  std::vector<Name> tableNames;
+  std::vector<Name> memoryNames;
+  std::vector<Name> globalNames;
+  std::vector<Name> tagNames;
+
+  // Function::materialize only lets one thread materialize at a time, so the
+  // reader is never used concurrently.
+  void materialize(Function* func, size_t start, size_t end) {
+    reader->pos = start - offset;
+    reader->endOfFunction = end - offset;
+    reader->readFunctionCode(func, false);
+    auto resolve = [&](auto& refs, const std::vector<Name>& names) {
+      for (auto& [index, uses] : refs) {
+        if (index >= names.size()) {
+          reader->throwError("invalid index in lazily read function");
+        }
+        for (auto* use : uses) {
+          *use = names[index];
+        }
+      }
+      refs.clear();
+    };
+    resolve(reader->functionRefs, functionNames);
+    resolve(reader->tableRefs, tableNames);
+    resolve(reader->memoryRefs, memoryNames);
+    resolve(reader->globalRefs, globalNames);
+    resolve(reader->tagRefs, tagNames);
+  }
+};
+
+namespace {
+
+struct LazyBody : public LazyFunctionBody {
+  std::shared_ptr<LazyFunctionReader> reader;
+  size_t start;
+  size_t end;
+
+  LazyBody(std::shared_ptr<LazyFunctionReader> reader, size_t start, size_t end)
+    : reader(reader), start(start), end(end) {}
+
+  void materialize(Function* func) override {
+    reader->materialize(func, start, end);
+  }
+};
+
+} // anonymous namespace
+
+void WasmBinaryBuilder::setUpLazyFunctions() {
+  auto lazy = std::make_shared<LazyFunctionReader>();
+  // Keep only the code we have not decoded.
+  auto start = lazyFunctions.front().start;
+  auto end = lazyFunctions.back().end;
+  lazy->code.assign(input.begin() + start, input.begin() + end);
+  lazy->offset = start;
+  lazy->reader = makeFunctionReader({lazy->code.data(), lazy->code.size()});
+  // Module elements were added in the order of their indexes in the binary.
+  auto getNames = [](auto& elements, std::vector<Name>& names) {
+    for (auto& curr : elements) {
+      names.push_back(curr->name);
+    }
+  };
+  getNames(wasm.functions, lazy->functionNames);
+  getNames(wasm.tables, lazy->tableNames);
+  getNames(wasm.memories, lazy->memoryNames);
+  getNames(wasm.globals, lazy->globalNames);
+  getNames(wasm.tags, lazy->tagNames);
+  for (auto& [func, start, end] : lazyFunctions) {
+    func->setLazyBody(std::make_unique<LazyBody>(lazy, start, end));
+  }
+  lazyFunctions.clear();
+}
+
 void WasmBinaryBuilder::readVars() {
   size_t numLocalTypes = getU32LEB();
   for (size_t t = 0; t < numLocalTypes; t++) {
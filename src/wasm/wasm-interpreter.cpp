@@ -1,4 +1,6 @@
 #include "wasm-interpreter.h"
+#include "ir/iteration.h"
+#include "ir/manipulation.h"
 
 namespace wasm {
 
@@ -23,4 +25,632 @@ std::ostream& operator<<(std::ostream& o, const WasmException& exn) {
   return o << exn.tag << " " << exn.values;
 }
 
+namespace {
+
+using Op = PrecompiledFunction::Op;
+
+bool isSlotType(Type type) {
+  return type == Type::i32 || type == Type::i64 || type == Type::f32 ||
+         type == Type::f64;
+}
+
+std::optional<Op> getUnaryOp(UnaryOp op) {
+  switch (op) {
+    case EqZInt32:
+      return Op::EqZInt32;
+    case EqZInt64:
+      return Op::EqZInt64;
+    case WrapInt64:
+      return Op::WrapInt64;
+    case ExtendSInt32:
+      return Op::ExtendSInt32;
+    case ExtendUInt32:
+      return Op::ExtendUInt32;
+    default:
+      return {};
+  }
+}
+
+std::optional<Op> getBinaryOp(BinaryOp op) {
+  switch (op) {
+    case AddInt32:
+      return Op::AddInt32;
+    case SubInt32:
+      return Op::SubInt32;
+    case MulInt32:
+      return Op::MulInt32;
+    case AndInt32:
+      return Op::AndInt32;
+    case OrInt32:
+      return Op::OrInt32;
+    case XorInt32:
+      return Op::XorInt32;
+    case ShlInt32:
+      return Op::ShlInt32;
+    case ShrSInt32:
+      return Op::ShrSInt32;
+    case ShrUInt32:
+      return Op::ShrUInt32;
+    case EqInt32:
+      return Op::EqInt32;
+    case NeInt32:
+      return Op::NeInt32;
+    case LtSInt32:
+      return Op::LtSInt32;
+    case LtUInt32:
+      return Op::LtUInt32;
+    case LeSInt32:
+      return Op::LeSInt32;
+    case LeUInt32:
+      return Op::LeUInt32;
+    case GtSInt32:
+      return Op::GtSInt32;
+    case GtUInt32:
+      return Op::GtUInt32;
+    case GeSInt32:
+      return Op::GeSInt32;
+    case GeUInt32:
+      return Op::GeUInt32;
+    case AddInt64:
+      return Op::AddInt64;
+    case SubInt64:
+      return Op::SubInt64;
+    case MulInt64:
+      return Op::MulInt64;
+    case AndInt64:
+      return Op::AndInt64;
+    case OrInt64:
+      return Op::OrInt64;
+    case XorInt64:
+      return Op::XorInt64;
+    case ShlInt64:
+      return Op::ShlInt64;
+    case ShrSInt64:
+      return Op::ShrSInt64;
+    case ShrUInt64:
+      return Op::ShrUInt64;
+    case EqInt64:
+      return Op::EqInt64;
+    case NeInt64:
+      return Op::NeInt64;
+    case LtSInt64:
+      return Op::LtSInt64;
+    case LtUInt64:
+      return Op::LtUInt64;
+    case LeSInt64:
+      return Op::LeSInt64;
+    case LeUInt64:
+      return Op::LeUInt64;
+    case GtSInt64:
+      return Op::GtSInt64;
+    case GtUInt64:
+      return Op::GtUInt64;
+    case GeSInt64:
+      return Op::GeSInt64;
+    case GeUInt64:
+      return Op::GeUInt64;
+    default:
+      return {};
+  }
+}
+
+struct Precompiler {
+  Module& wasm;
+  PrecompiledFunction& out;
+
+  // The first free slot for temporaries.
+  Index top;
+
+  // Set when we see something we cannot lower.
+  bool failed = false;
+
+  struct Label {
+    Name name;
+    // The slot a branch with a value writes it to.
+    Index dst;
+    // For a loop, the start of it. Otherwise the jumps we must point at the
+    // end of the block once we reach it.
+    std::optional<Index> start;
+    std::vector<Index> jumps;
+  };
+  // Labels may shadow each other, so we look them up from the innermost.
+  std::vector<Label> labels;
+
+  Precompiler(Module& wasm, PrecompiledFunction& out, Index numLocals)
+    : wasm(wasm), out(out), top(numLocals) {
+    out.numSlots = numLocals;
+  }
+
+  Index allocate() {
+    auto slot = top++;
+    out.numSlots = std::max(out.numSlots, top);
+    return slot;
+  }
+
+  Index here() { return out.code.size(); }
+
+  Index emit(Op op, Index dst = 0, Index a = 0, Index b = 0, uint64_t imm = 0) {
+    out.code.push_back({op, dst, a, b, imm});
+    return out.code.size() - 1;
+  }
+
+  Label& getLabel(Name name) {
+    for (auto i = labels.rbegin(); i != labels.rend(); ++i) {
+      if (i->name == name) {
+        return *i;
+      }
+    }
+    WASM_UNREACHABLE("missing label");
+  }
+
+  void emitJump(Label& label, Op op = Op::Jump, Index condition = 0) {
+    auto jump = emit(op, 0, condition);
+    if (label.start) {
+      out.code[jump].imm = *label.start;
+    } else {
+      label.jumps.push_back(jump);
+    }
+  }
+
+  // Emits code that computes |curr| and writes its value, if it has one, to
+  // |dst|.
+  void compile(Expression* curr, Index dst) {
+    if (failed) {
+      return;
+    }
+    if (curr->type.isConcrete() && !isSlotType(curr->type)) {
+      failed = true;
+      return;
+    }
+    // Temporaries are freed when we are done with the expression.
+    auto oldTop = top;
+    switch (curr->_id) {
+      case Expression::BlockId:
+        compileBlock(curr->cast<Block>(), dst);
+        break;
+      case Expression::IfId:
+        compileIf(curr->cast<If>(), dst);
+        break;
+      case Expression::LoopId: {
+        auto* loop = curr->cast<Loop>();
+        labels.push_back({loop->name, dst, here(), {}});
+        compile(loop->body, dst);
+        labels.pop_back();
+        break;
+      }
+      case Expression::BreakId:
+        compileBreak(curr->cast<Break>(), dst);
+        break;
+      case Expression::SwitchId:
+        compileSwitch(curr->cast<Switch>());
+        break;
+      case Expression::ReturnId: {
+        auto* ret = curr->cast<Return>();
+        if (ret->value) {
+          auto value = allocate();
+          compile(ret->value, value);
+          if (ret->value->type != Type::unreachable) {
+            emit(Op::Return, 0, value);
+          }
+        } else {
+          emit(Op::ReturnNone);
+        }
+        break;
+      }
+      case Expression::ConstId:
+        emit(Op::Const,
+             dst,
+             0,
+             0,
+             PrecompiledFunction::toBits(curr->cast<Const>()->value));
+        break;
+      case Expression::LocalGetId:
+        emit(Op::Copy, dst, curr->cast<LocalGet>()->index);
+        break;
+      case Expression::LocalSetId: {
+        auto* set = curr->cast<LocalSet>();
+        // Compute the value in a temporary, as the local may be read while we
+        // compute it.
+        auto value = set->isTee() ? dst : allocate();
+        compile(set->value, value);
+        if (set->value->type != Type::unreachable) {
+          emit(Op::Copy, set->index, value);
+        }
+        break;
+      }
+      case Expression::GlobalGetId:
+        // Reads of imported globals are visited, so that the runner may
+        // customize them.
+        if (wasm.getGlobal(curr->cast<GlobalGet>()->name)->imported()) {
+          compileVisit(curr, dst);
+        } else {
+          emit(Op::GlobalGet, dst);
+          out.code.back().expr = curr;
+        }
+        break;
+      case Expression::GlobalSetId: {
+        auto* set = curr->cast<GlobalSet>();
+        if (wasm.getGlobal(set->name)->imported()) {
+          compileVisit(curr, dst);
+          break;
+        }
+        auto value = allocate();
+        compile(set->value, value);
+        if (set->value->type != Type::unreachable) {
+          emit(Op::GlobalSet, 0, value);
+          out.code.back().expr = curr;
+        }
+        break;
+      }
+      case Expression::CallId:
+        compileCall(curr->cast<Call>(), dst);
+        break;
+      case Expression::LoadId: {
+        auto* load = curr->cast<Load>();
+        if (!isSlotType(load->type)) {
+          failed = true;
+          break;
+        }
+        auto ptr = allocate();
+        compile(load->ptr, ptr);
+        if (load->ptr->type != Type::unreachable) {
+          emit(Op::Load, dst, ptr);
+          out.code.back().expr = curr;
+        }
+        break;
+      }
+      case Expression::StoreId: {
+        auto* store = curr->cast<Store>();
+        if (!isSlotType(store->valueType)) {
+          failed = true;
+          break;
+        }
+        auto ptr = allocate();
+        auto value = allocate();
+        compile(store->ptr, ptr);
+        compile(store->value, value);
+        if (store->ptr->type != Type::unreachable &&
+            store->value->type != Type::unreachable) {
+          emit(Op::Store, 0, ptr, value);
+          out.code.back().expr = curr;
+        }
+        break;
+      }
+      case Expression::UnaryId: {
+        auto* unary = curr->cast<Unary>();
+        auto op = getUnaryOp(unary->op);
+        if (!op) {
+          compileVisit(curr, dst);
+          break;
+        }
+        compile(unary->value, dst);
+        if (unary->value->type != Type::unreachable) {
+          emit(*op, dst, dst);
+        }
+        break;
+      }
+      case Expression::BinaryId: {
+        auto* binary = curr->cast<Binary>();
+        auto op = getBinaryOp(binary->op);
+        if (!op) {
+          compileVisit(curr, dst);
+          break;
+        }
+        // The left side is computed in a slot of its own rather than in the
+        // destination, as a branch in the right side may reach a place where
+        // the destination is still live.
+        auto left = allocate();
+        auto right = allocate();
+        compile(binary->left, left);
+        if (binary->left->type == Type::unreachable) {
+          break;
+        }
+        compile(binary->right, right);
+        if (binary->right->type != Type::unreachable) {
+          emit(*op, dst, left, right);
+        }
+        break;
+      }
+      case Expression::SelectId: {
+        auto* select = curr->cast<Select>();
+        // As with a binary, the first operand does not use the destination.
+        auto ifTrue = allocate();
+        auto ifFalse = allocate();
+        auto condition = allocate();
+        compile(select->ifTrue, ifTrue);
+        if (select->ifTrue->type == Type::unreachable) {
+          break;
+        }
+        compile(select->ifFalse, ifFalse);
+        if (select->ifFalse->type == Type::unreachable) {
+          break;
+        }
+        compile(select->condition, condition);
+        if (select->condition->type != Type::unreachable) {
+          emit(Op::Select, dst, ifTrue, ifFalse, condition);
+        }
+        break;
+      }
+      case Expression::DropId:
+        compile(curr->cast<Drop>()->value, allocate());
+        break;
+      case Expression::NopId:
+        break;
+      case Expression::UnreachableId:
+        emit(Op::Unreachable);
+        break;
+      case Expression::CallIndirectId:
+        // A return call needs the results of the function being interpreted.
+        if (curr->cast<CallIndirect>()->isReturn) {
+          failed = true;
+          break;
+        }
+        compileVisit(curr, dst);
+        break;
+      case Expression::TryId:
+      case Expression::RethrowId:
+      case Expression::PopId:
+      case Expression::TupleMakeId:
+      case Expression::TupleExtractId:
+      case Expression::BrOnId:
+        failed = true;
+        break;
+      default:
+        compileVisit(curr, dst);
+    }
+    top = oldTop;
+  }
+
+  void compileBlock(Block* curr, Index dst) {
+    labels.push_back({curr->name, dst, {}, {}});
+    for (Index i = 0; i < curr->list.size(); i++) {
+      auto* child = curr->list[i];
+      auto oldTop = top;
+      compile(child, i + 1 == curr->list.size() ? dst : allocate());
+      top = oldTop;
+      if (child->type == Type::unreachable) {
+        // The rest is never reached.
+        break;
+      }
+    }
+    for (auto jump : labels.back().jumps) {
+      out.code[jump].imm = here();
+    }
+    labels.pop_back();
+  }
+
+  void compileIf(If* curr, Index dst) {
+    auto condition = allocate();
+    compile(curr->condition, condition);
+    if (curr->condition->type == Type::unreachable) {
+      return;
+    }
+    auto toElse = emit(Op::JumpIfNot, 0, condition);
+    compile(curr->ifTrue, dst);
+    if (curr->ifFalse) {
+      auto toEnd = emit(Op::Jump);
+      out.code[toElse].imm = here();
+      compile(curr->ifFalse, dst);
+      out.code[toEnd].imm = here();
+    } else {
+      out.code[toElse].imm = here();
+    }
+  }
+
+  void compileBreak(Break* curr, Index dst) {
+    if (!curr->condition) {
+      if (curr->value) {
+        // The value may contain branches to labels inside it, which continue
+        // in code where the target's slot may still be live, so we must not
+        // write to that slot before we leave.
+        auto value = allocate();
+        compile(curr->value, value);
+        if (curr->value->type == Type::unreachable) {
+          return;
+        }
+        // Look the label up only now, as compiling the value may add labels
+        // and move the existing ones.
+        emit(Op::Copy, getLabel(curr->name).dst, value);
+      }
+      emitJump(getLabel(curr->name));
+      return;
+    }
+    auto condition = allocate();
+    if (curr->value) {
+      // The value flows out if we do not branch, so compute it in our
+      // destination and copy it to the target's if we do.
+      compile(curr->value, dst);
+      if (curr->value->type == Type::unreachable) {
+        return;
+      }
+      compile(curr->condition, condition);
+      if (curr->condition->type == Type::unreachable) {
+        return;
+      }
+      auto skip = emit(Op::JumpIfNot, 0, condition);
+      auto& label = getLabel(curr->name);
+      emit(Op::Copy, label.dst, dst);
+      emitJump(label);
+      out.code[skip].imm = here();
+      return;
+    }
+    compile(curr->condition, condition);
+    if (curr->condition->type != Type::unreachable) {
+      emitJump(getLabel(curr->name), Op::JumpIf, condition);
+    }
+  }
+
+  void compileSwitch(Switch* curr) {
+    auto value = allocate();
+    auto condition = allocate();
+    if (curr->value) {
+      compile(curr->value, value);
+      if (curr->value->type == Type::unreachable) {
+        return;
+      }
+    }
+    compile(curr->condition, condition);
+    if (curr->condition->type == Type::unreachable) {
+      return;
+    }
+    auto index = out.tables.size();
+    emit(Op::Switch, 0, condition, 0, index);
+    // Each target gets a short sequence of code that copies the value to it,
+    // if there is one, and jumps there.
+    std::unordered_map<Name, Index> targets;
+    auto getTarget = [&](Name name) {
+      auto [iter, inserted] = targets.insert({name, here()});
+      if (inserted) {
+        auto& label = getLabel(name);
+        if (curr->value) {
+          emit(Op::Copy, label.dst, value);
+        }
+        emitJump(label);
+      }
+      return iter->second;
+    };
+    std::vector<Index> table;
+    for (auto target : curr->targets) {
+      table.push_back(getTarget(target));
+    }
+    table.push_back(getTarget(curr->default_));
+    out.tables.push_back(std::move(table));
+  }
+
+  void compileCall(Call* curr, Index dst) {
+    auto* target = wasm.getFunction(curr->target);
+    auto results = target->getResults();
+    if ((results != Type::none && !isSlotType(results)) ||
+        Intrinsics(wasm).isCallWithoutEffects(target)) {
+      failed = true;
+      return;
+    }
+    Index operands = top;
+    for (Index i = 0; i < curr->operands.size(); i++) {
+      allocate();
+    }
+    for (Index i = 0; i < curr->operands.size(); i++) {
+      auto* operand = curr->operands[i];
+      if (!isSlotType(operand->type) && operand->type != Type::unreachable) {
+        failed = true;
+        return;
+      }
+      compile(operand, operands + i);
+      if (operand->type == Type::unreachable) {
+        return;
+      }
+    }
+    // A return call has no value of its own, but returns the target's.
+    if (curr->isReturn) {
+      dst = allocate();
+    }
+    emit(Op::Call, dst, operands, 0, curr->isReturn);
+    out.code.back().func = target;
+  }
+
+  // Emits code that computes the children of |curr| and then visits a copy of
+  // it whose children are Consts, which we set to the children's values.
+  void compileVisit(Expression* curr, Index dst) {
+    if (curr->type.isConcrete() && !isSlotType(curr->type)) {
+      failed = true;
+      return;
+    }
+    ChildIterator children(curr);
+    Index operands = top;
+    for (Index i = 0; i < children.children.size(); i++) {
+      allocate();
+    }
+    Index i = 0;
+    for (auto* child : children) {
+      if (!isSlotType(child->type) && child->type != Type::unreachable) {
+        failed = true;
+        return;
+      }
+      compile(child, operands + i++);
+      if (child->type == Type::unreachable) {
+        return;
+      }
+    }
+    auto* copy = ExpressionManipulator::flexibleCopy(
+      curr, wasm, [&](Expression* child) -> Expression* {
+        // Copy only |curr| itself, and keep the children for now.
+        return child == curr ? nullptr : child;
+      });
+    std::vector<Const*> consts;
+    for (auto*& child : ChildIterator(copy)) {
+      auto* c = Builder(wasm).makeConst(Literal::makeZero(child->type));
+      child = c;
+      consts.push_back(c);
+    }
+    emit(Op::Visit, dst, operands, 0, out.visitOperands.size());
+    out.code.back().expr = copy;
+    out.visitOperands.push_back(std::move(consts));
+  }
+};
+
+} // anonymous namespace
+
+std::unique_ptr<PrecompiledFunction>
+PrecompiledFunction::compile(Function* func, Module& wasm) {
+  auto ret = std::make_unique<PrecompiledFunction>();
+  ret->body = func->body;
+  for (auto type : func->vars) {
+    if (!isSlotType(type)) {
+      return ret;
+    }
+  }
+  for (auto type : func->getParams()) {
+    if (!isSlotType(type)) {
+      return ret;
+    }
+  }
+  auto results = func->getResults();
+  if (results != Type::none && !isSlotType(results)) {
+    return ret;
+  }
+  Precompiler precompiler(wasm, *ret, func->getNumLocals());
+  auto result = precompiler.allocate();
+  precompiler.compile(func->body, result);
+  if (precompiler.failed) {
+    return ret;
+  }
+  if (results == Type::none) {
+    precompiler.emit(Op::ReturnNone);
+  } else {
+    precompiler.emit(Op::Return, 0, result);
+  }
+  ret->valid = true;
+  return ret;
+}
+
+uint64_t PrecompiledFunction::toBits(const Literal& value) {
+  switch (value.type.getBasic()) {
+    case Type::i32:
+      return uint32_t(value.geti32());
+    case Type::i64:
+      return value.geti64();
+    case Type::f32:
+      return uint32_t(value.reinterpreti32());
+    case Type::f64:
+      return value.reinterpreti64();
+    default:
+      WASM_UNREACHABLE("unexpected type");
+  }
+}
+
+Literal PrecompiledFunction::fromBits(uint64_t bits, Type type) {
+  switch (type.getBasic()) {
+    case Type::i32:
+      return Literal(int32_t(bits));
+    case Type::i64:
+      return Literal(int64_t(bits));
+    case Type::f32:
+      return Literal(int32_t(bits)).castToF32();
+    case Type::f64:
+      return Literal(int64_t(bits)).castToF64();
+    default:
+      WASM_UNREACHABLE("unexpected type");
+  }
+}
+
 } // namespace wasm
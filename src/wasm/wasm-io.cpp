@@ -57,7 +57,7 @@ void ModuleReader::readText(std::string filename, Module& wasm) {
   readTextData(input, wasm, profile);
 }
 
-void ModuleReader::readBinaryData(std::vector<char>& input,
+void ModuleReader::readBinaryData(std::string_view input,
                                   Module& wasm,
                                   std::string sourceMapFilename) {
   std::unique_ptr<std::ifstream> sourceMapStream;
@@ -67,6 +67,7 @@ void ModuleReader::readBinaryData(std::vector<char>& input,
   parser.setDebugInfo(debugInfo);
   parser.setDWARF(DWARF);
   parser.setSkipFunctionBodies(skipFunctionBodies);
+  parser.setLazyFunctionBodies(lazyFunctionBodies);
   if (sourceMapFilename.size()) {
     sourceMapStream = make_unique<std::ifstream>();
     sourceMapStream->open(sourceMapFilename);
@@ -82,8 +83,10 @@ void ModuleReader::readBinary(std::string filename,
                               Module& wasm,
                               std::string sourceMapFilename) {
   BYN_TRACE("reading binary from " << filename << "\n");
-  auto input(read_file<std::vector<char>>(filename, Flags::Binary));
-  readBinaryData(input, wasm, sourceMapFilename);
+  // Parse directly from the mapped file rather than copying it into memory
+  // first.
+  MappedFile input(filename);
+  readBinaryData(input.data(), wasm, sourceMapFilename);
 }
 
 bool ModuleReader::isBinaryFile(std::string filename) {
@@ -123,7 +126,7 @@ void ModuleReader::readStdin(Module& wasm, std::string sourceMapFilename) {
   std::vector<char> input = read_stdin();
   if (input.size() >= 4 && input[0] == '\0' && input[1] == 'a' &&
       input[2] == 's' && input[3] == 'm') {
-    readBinaryData(input, wasm, sourceMapFilename);
+    readBinaryData({input.data(), input.size()}, wasm, sourceMapFilename);
   } else {
     std::ostringstream s;
     s.write(input.data(), input.size());
@@ -149,6 +152,11 @@ void ModuleWriter::writeText(Module& wasm, std::string filename) {
 void ModuleWriter::writeBinary(Module& wasm, Output& output) {
   BufferWithRandomAccess buffer;
   WasmBinaryWriter writer(&wasm, buffer);
+  // Write each section as it is finished, rather than keeping the entire
+  // binary in memory.
+  writer.setStreamingOutput([&](const uint8_t* data, size_t size) {
+    output.write((const char*)data, size);
+  });
   // if debug info is used, then we want to emit the names section
   writer.setNamesSection(debugInfo);
   if (emitModuleName) {
@@ -164,7 +172,6 @@ void ModuleWriter::writeBinary(Module& wasm, Output& output) {
     writer.setSymbolMap(symbolMap);
   }
   writer.write();
-  buffer.writeTo(output);
   if (sourceMapStream) {
     sourceMapStream->close();
   }
@@ -16,8 +16,10 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <map>
+#include <optional>
 #include <shared_mutex>
 #include <sstream>
 #include <unordered_map>
@@ -656,8 +658,33 @@ bool HeapTypeInfo::operator==(const HeapTypeInfo& other) const {
   return this == &other;
 }
 
+// A readers-writer lock for the global stores. Most insertions into the stores
+// find that the type already exists, so lookups only take the lock in shared
+// mode and can proceed in parallel, and only the insertion of a new type takes
+// it exclusively. Counts how often a thread had to wait for the lock so that
+// the remaining contention can be measured.
+struct StoreMutex {
+  std::shared_mutex mutex;
+  std::atomic<size_t> contended{0};
+
+  void lock() {
+    if (!mutex.try_lock()) {
+      contended.fetch_add(1, std::memory_order_relaxed);
+      mutex.lock();
+    }
+  }
+  void unlock() { mutex.unlock(); }
+  void lock_shared() {
+    if (!mutex.try_lock_shared()) {
+      contended.fetch_add(1, std::memory_order_relaxed);
+      mutex.lock_shared();
+    }
+  }
+  void unlock_shared() { mutex.unlock_shared(); }
+};
+
 template<typename Info> struct Store {
-  std::recursive_mutex mutex;
+  StoreMutex mutex;
 
   // Track unique_ptrs for constructed types to avoid leaks.
   std::vector<std::unique_ptr<Info>> constructedTypes;
@@ -673,6 +700,11 @@ template<typename Info> struct Store {
   typename Info::type_t insert(std::unique_ptr<Info>&& info) {
     return doInsert(info);
   }
+  // Like `insert`, but for use when the caller already holds `mutex` in
+  // exclusive mode.
+  typename Info::type_t insertLocked(std::unique_ptr<Info>&& info) {
+    return doInsert<std::unique_ptr<Info>, true>(info);
+  }
   bool hasCanonical(const Info& info, typename Info::type_t& canonical);
 
   void clear() {
@@ -681,7 +713,8 @@ template<typename Info> struct Store {
   }
 
 private:
-  template<typename Ref> typename Info::type_t doInsert(Ref& infoRef) {
+  template<typename Ref, bool Locked = false>
+  typename Info::type_t doInsert(Ref& infoRef) {
     const Info& info = [&]() {
       if constexpr (std::is_same_v<Ref, const Info>) {
         return infoRef;
@@ -709,24 +742,48 @@ private:
       return typename Info::type_t(id);
     };
 
+    auto find = [&]() -> std::optional<typename Info::type_t> {
+      auto indexIt = typeIDs.find(std::cref(info));
+      if (indexIt != typeIDs.end()) {
+        return typename Info::type_t(indexIt->second);
+      }
+      return {};
+    };
+
     // Turn e.g. (ref null any) into anyref.
     if (auto canonical = info.getCanonical()) {
       return *canonical;
     }
-    std::lock_guard<std::recursive_mutex> lock(mutex);
-    // Nominal HeapTypes are always unique, so don't bother deduplicating them.
-    if constexpr (std::is_same_v<Info, HeapTypeInfo>) {
-      if (typeSystem == TypeSystem::Nominal) {
-        return insertNew();
+    if constexpr (Locked) {
+      // Nominal HeapTypes are always unique, so don't bother deduplicating
+      // them.
+      if constexpr (std::is_same_v<Info, HeapTypeInfo>) {
+        if (typeSystem == TypeSystem::Nominal) {
+          return insertNew();
+        }
       }
+      if (auto existing = find()) {
+        return *existing;
+      }
+      return insertNew();
+    } else {
+      bool nominal = false;
+      if constexpr (std::is_same_v<Info, HeapTypeInfo>) {
+        nominal = typeSystem == TypeSystem::Nominal;
+      }
+      // Check whether we already have a type for this structural Info. This is
+      // the common case, so do it under a shared lock.
+      if (!nominal) {
+        std::shared_lock<StoreMutex> lock(mutex);
+        if (auto existing = find()) {
+          return *existing;
+        }
+      }
+      // We do not have a type for this Info already. Create one, unless another
+      // thread beat us to it in the meantime.
+      std::unique_lock<StoreMutex> lock(mutex);
+      return doInsert<Ref, true>(infoRef);
     }
-    // Check whether we already have a type for this structural Info.
-    auto indexIt = typeIDs.find(std::cref(info));
-    if (indexIt != typeIDs.end()) {
-      return typename Info::type_t(indexIt->second);
-    }
-    // We do not have a type for this Info already. Create one.
-    return insertNew();
   }
 };
 
@@ -789,7 +846,7 @@ static SignatureTypeCache nominalSignatureCache;
 
 // Keep track of the constructed recursion groups.
 struct RecGroupStore {
-  std::mutex mutex;
+  StoreMutex mutex;
   // Store the structures of all rec groups created so far so we can avoid
   // creating duplicates.
   std::unordered_set<RecGroupStructure> canonicalGroups;
@@ -797,6 +854,7 @@ struct RecGroupStore {
   // `canonicalGroups` alive.
   std::vector<std::unique_ptr<RecGroupInfo>> builtGroups;
 
+  // The following two overloads must be called with `mutex` held exclusively.
   RecGroup insert(RecGroup group) {
     RecGroupStructure structure{group};
     auto [it, inserted] = canonicalGroups.insert(structure);
@@ -818,9 +876,18 @@ struct RecGroupStore {
 
   // Utility for canonicalizing HeapTypes with trivial recursion groups.
   HeapType insert(std::unique_ptr<HeapTypeInfo>&& info) {
-    std::lock_guard<std::mutex> lock(mutex);
     assert(!info->recGroup && "Unexpected nontrivial rec group");
     auto group = asHeapType(info).getRecGroup();
+    {
+      // Usually there is already an equivalent group, so look for it under a
+      // shared lock first.
+      std::shared_lock<StoreMutex> lock(mutex);
+      auto it = canonicalGroups.find(RecGroupStructure{group});
+      if (it != canonicalGroups.end()) {
+        return it->group[0];
+      }
+    }
+    std::unique_lock<StoreMutex> lock(mutex);
     auto canonical = insert(group);
     if (group == canonical) {
       globalHeapTypeStore.insert(std::move(info));
@@ -838,6 +905,12 @@ static RecGroupStore globalRecGroupStore;
 
 } // anonymous namespace
 
+size_t getTypeStoreContention() {
+  return globalTypeStore.mutex.contended.load() +
+         globalHeapTypeStore.mutex.contended.load() +
+         globalRecGroupStore.mutex.contended.load();
+}
+
 void destroyAllTypesForTestingPurposesOnly() {
   globalTypeStore.clear();
   globalHeapTypeStore.clear();
@@ -2627,11 +2700,11 @@ void globallyCanonicalize(CanonicalizationState& state) {
   // same shape as one being canonicalized here. This cannot happen with Types
   // because they are hashed in the global store by pointer identity, which has
   // not yet escaped the builder, rather than shape.
-  std::lock_guard<std::recursive_mutex> lock(globalHeapTypeStore.mutex);
+  std::unique_lock<StoreMutex> lock(globalHeapTypeStore.mutex);
   std::unordered_map<HeapType, HeapType> canonicalHeapTypes;
   for (auto& info : state.newInfos) {
     HeapType original = asHeapType(info);
-    HeapType canonical = globalHeapTypeStore.insert(std::move(info));
+    HeapType canonical = globalHeapTypeStore.insertLocked(std::move(info));
     if (original != canonical) {
       canonicalHeapTypes[original] = canonical;
     }
@@ -2820,7 +2893,7 @@ std::optional<TypeBuilder::Error> canonicalizeIsorecursive(
   // replacements accordingly.
   CanonicalizationState::ReplacementMap replacements;
   {
-    std::lock_guard<std::mutex> lock(globalRecGroupStore.mutex);
+    std::unique_lock<StoreMutex> lock(globalRecGroupStore.mutex);
     groupStart = 0;
     for (auto group : groups) {
       size_t size = group.size();
@@ -3543,6 +3543,7 @@ static void validateClosedWorldInterface(Module& module, ValidationInfo& info) {
 // then Using PassRunner::getPassDebug causes a circular dependence. We should
 // fix that, perhaps by moving some of the pass infrastructure into libsupport.
 bool WasmValidator::validate(Module& module, Flags flags) {
+  ModuleUtils::materializeFunctions(module);
   ValidationInfo info(module);
   info.validateWeb = (flags & Web) != 0;
   info.validateGlobally = (flags & Globally) != 0;
@@ -3589,6 +3590,7 @@ bool WasmValidator::validate(Module& module, const PassOptions& options) {
 }
 
 bool WasmValidator::validate(Function* func, Module& module, Flags flags) {
+  func->materialize();
   ValidationInfo info(module);
   info.validateWeb = (flags & Web) != 0;
   info.validateGlobally = (flags & Globally) != 0;
@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <mutex>
+
 #include "wasm.h"
 #include "ir/branch-utils.h"
 #include "wasm-traversal.h"
@@ -1324,6 +1326,25 @@ void Function::clearDebugInfo() {
   epilogLocation.clear();
 }
 
+void Function::setLazyBody(std::unique_ptr<LazyFunctionBody> body) {
+  lazyBody = std::move(body);
+  lazy.store(true, std::memory_order_release);
+}
+
+void Function::materializeLazy() {
+  // Passes may use functions from multiple threads, so several may try to
+  // materialize the same function at once. Only one of them may decode it, and
+  // the others must wait until it is done. Only lazy functions get here, so
+  // other modules never take this lock.
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (lazyBody) {
+    auto body = std::move(lazyBody);
+    body->materialize(this);
+    lazy.store(false, std::memory_order_release);
+  }
+}
+
 template<typename Map>
 typename Map::mapped_type&
 getModuleElement(Map& m, Name name, const std::string& funcName) {
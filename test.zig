@@ -33,3 +33,110 @@ test "parse wat" {
     defer binaryen.freeEmit(out);
     try std.testing.expectEqualStrings(src, out);
 }
+
+fn optimize(allocator: std.mem.Allocator, wat: [*:0]const u8) ![]u8 {
+    const mod = binaryen.Module.parseText(wat);
+    defer mod.deinit();
+    mod.optimize();
+    const out = mod.emitText();
+    defer binaryen.freeEmit(out);
+    return allocator.dupe(u8, out);
+}
+
+// Maps the entries in a function cache to their inodes, which change when an
+// entry is written again.
+fn readCache(
+    allocator: std.mem.Allocator,
+    dir: std.fs.IterableDir,
+) !std.StringHashMap(std.fs.File.INode) {
+    var entries = std.StringHashMap(std.fs.File.INode).init(allocator);
+    var it = dir.iterate();
+    while (try it.next()) |entry| {
+        const stat = try dir.dir.statFile(entry.name);
+        try entries.put(try allocator.dupe(u8, entry.name), stat.inode);
+    }
+    return entries;
+}
+
+test "function cache" {
+    var arena = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena.deinit();
+    const allocator = arena.allocator();
+
+    var tmp = std.testing.tmpIterableDir(.{});
+    defer tmp.cleanup();
+    const dir = try tmp.iterable_dir.dir.realpathAlloc(allocator, ".");
+
+    const src =
+        \\(module
+        \\ (export "add" (func $add))
+        \\ (export "sub" (func $sub))
+        \\ (func $add (param $0 i32) (param $1 i32) (result i32)
+        \\  (i32.add
+        \\   (i32.add
+        \\    (local.get $0)
+        \\    (local.get $1)
+        \\   )
+        \\   (i32.const 0)
+        \\  )
+        \\ )
+        \\ (func $sub (param $0 i32) (result i32)
+        \\  (i32.sub
+        \\   (local.get $0)
+        \\   (i32.const 0)
+        \\  )
+        \\ )
+        \\)
+        \\
+    ;
+    // The same module with one function changed.
+    const changed =
+        \\(module
+        \\ (export "add" (func $add))
+        \\ (export "sub" (func $sub))
+        \\ (func $add (param $0 i32) (param $1 i32) (result i32)
+        \\  (i32.add
+        \\   (i32.add
+        \\    (local.get $0)
+        \\    (local.get $1)
+        \\   )
+        \\   (i32.const 0)
+        \\  )
+        \\ )
+        \\ (func $sub (param $0 i32) (result i32)
+        \\  (i32.sub
+        \\   (local.get $0)
+        \\   (i32.const 1)
+        \\  )
+        \\ )
+        \\)
+        \\
+    ;
+    const expected = try optimize(allocator, src);
+    const expected_changed = try optimize(allocator, changed);
+
+    binaryen.setFunctionCache(try allocator.dupeZ(u8, dir));
+    defer binaryen.setFunctionCache(null);
+
+    // Nothing is cached at first, so the results are computed and stored.
+    try std.testing.expectEqualStrings(expected, try optimize(allocator, src));
+    const stored = try readCache(allocator, tmp.iterable_dir);
+    try std.testing.expect(stored.count() > 0);
+
+    // Now every function is found in the cache, so nothing is written again.
+    try std.testing.expectEqualStrings(expected, try optimize(allocator, src));
+    const reused = try readCache(allocator, tmp.iterable_dir);
+    try std.testing.expectEqual(stored.count(), reused.count());
+    var it = stored.iterator();
+    while (it.next()) |entry| {
+        const inode = reused.get(entry.key_ptr.*).?;
+        try std.testing.expectEqual(entry.value_ptr.*, inode);
+    }
+
+    // The changed function no longer matches its entries, so it is optimized
+    // again and new entries are stored.
+    const result = try optimize(allocator, changed);
+    try std.testing.expectEqualStrings(expected_changed, result);
+    const updated = try readCache(allocator, tmp.iterable_dir);
+    try std.testing.expect(updated.count() > stored.count());
+}
@@ -0,0 +1,76 @@
+;; Branches out of the operands of expressions whose values go to slots that
+;; are still live. Run with wasm-shell --precompile to check the precompiled
+;; engine against the interpreter.
+
+(module
+  (func (export "br-value-br") (result i32)
+    (block $out (result i32)
+      (i32.add
+        (i32.const 1)
+        (block $mid (result i32)
+          (br $out
+            (i32.add
+              (i32.const 5)
+              (br $mid (i32.const 10))
+            )
+          )
+        )
+      )
+    )
+  )
+
+  (func (export "br-value-br-if") (param $x i32) (result i32)
+    (block $out (result i32)
+      (i32.add
+        (i32.const 1)
+        (block $mid (result i32)
+          (br $out
+            (i32.add
+              (i32.const 5)
+              (br_if $mid (i32.const 10) (local.get $x))
+            )
+          )
+        )
+      )
+    )
+  )
+
+  (func (export "binary-right-br") (result i32)
+    (block $out (result i32)
+      (i32.sub
+        (i32.const 100)
+        (block $mid (result i32)
+          (drop
+            (br_if $out (i32.const 7) (i32.const 0))
+          )
+          (br $mid (i32.const 3))
+        )
+      )
+    )
+  )
+
+  (func (export "select-br") (param $x i32) (result i32)
+    (block $out (result i32)
+      (select
+        (i32.const 1)
+        (block $mid (result i32)
+          (br $out
+            (select
+              (i32.const 2)
+              (br $mid (i32.const 3))
+              (local.get $x)
+            )
+          )
+        )
+        (local.get $x)
+      )
+    )
+  )
+)
+
+(assert_return (invoke "br-value-br") (i32.const 11))
+(assert_return (invoke "br-value-br-if" (i32.const 1)) (i32.const 11))
+(assert_return (invoke "br-value-br-if" (i32.const 0)) (i32.const 15))
+(assert_return (invoke "binary-right-br") (i32.const 97))
+(assert_return (invoke "select-br" (i32.const 1)) (i32.const 1))
+(assert_return (invoke "select-br" (i32.const 0)) (i32.const 3))